@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace OrderBook{
+
+	//Sorted set stored as a B+-tree of height two: cache-line aligned leaves of up to
+	//kLeafCapacity contiguous values and a flat index holding the first value of every
+	//leaf. In-order iteration is a linear scan of each leaf, and a lookup is a binary
+	//search over the index followed by one inside the leaf. Not thread-safe.
+	template<typename T, typename Comparator, size_t kLeafCapacity = 64>
+	class BlockSortedSet{
+	public:
+		bool Insert(const T& value);
+		bool Erase(const T& value);
+		size_t Size() const { return size_; }
+
+		template<typename F>
+		void ForEach(F f) const;
+
+	private:
+		struct alignas(64) Leaf{
+			std::array<T, kLeafCapacity> values_;
+			size_t size_ = 0;
+		};
+
+		size_t FindLeaf(const T& value) const;
+		void Split(size_t leaf);
+		void Shrink(size_t leaf);
+
+	private:
+		std::vector<std::unique_ptr<Leaf>> leaves_;
+		std::vector<T> firsts_;
+		size_t size_ = 0;
+		Comparator cmp_;
+	};
+
+
+	template<typename T, typename C, size_t K>
+	size_t BlockSortedSet<T, C, K>::FindLeaf(const T& value) const{
+		auto It = std::upper_bound(firsts_.begin(), firsts_.end(), value, cmp_);
+		return It == firsts_.begin() ? 0 : static_cast<size_t>(It - firsts_.begin()) - 1;
+	}
+
+	template<typename T, typename C, size_t K>
+	bool BlockSortedSet<T, C, K>::Insert(const T& value){
+		if(leaves_.empty()){
+			leaves_.push_back(std::make_unique<Leaf>());
+			firsts_.push_back(value);
+		}
+		size_t index = FindLeaf(value);
+		Leaf* leaf = leaves_[index].get();
+		T* end = leaf->values_.data() + leaf->size_;
+		T* pos = std::lower_bound(leaf->values_.data(), end, value, cmp_);
+		if(pos != end && !cmp_(value, *pos)){
+			return false;
+		}
+		if(leaf->size_ == K){
+			Split(index);
+			return Insert(value);
+		}
+		std::move_backward(pos, end, end + 1);
+		*pos = value;
+		++leaf->size_;
+		firsts_[index] = leaf->values_[0];
+		++size_;
+		return true;
+	}
+
+	template<typename T, typename C, size_t K>
+	bool BlockSortedSet<T, C, K>::Erase(const T& value){
+		if(leaves_.empty()){
+			return false;
+		}
+		size_t index = FindLeaf(value);
+		Leaf* leaf = leaves_[index].get();
+		T* end = leaf->values_.data() + leaf->size_;
+		T* pos = std::lower_bound(leaf->values_.data(), end, value, cmp_);
+		if(pos == end || cmp_(value, *pos)){
+			return false;
+		}
+		std::move(pos + 1, end, pos);
+		--leaf->size_;
+		--size_;
+		Shrink(index);
+		return true;
+	}
+
+	template<typename T, typename C, size_t K>
+	void BlockSortedSet<T, C, K>::Split(size_t index){
+		Leaf* leaf = leaves_[index].get();
+		auto right = std::make_unique<Leaf>();
+		size_t half = K/2;
+		std::move(leaf->values_.begin() + half, leaf->values_.begin() + K, right->values_.begin());
+		right->size_ = K - half;
+		leaf->size_ = half;
+		firsts_.insert(firsts_.begin() + index + 1, right->values_[0]);
+		leaves_.insert(leaves_.begin() + index + 1, std::move(right));
+	}
+
+	//Drops an empty leaf. A leaf that fell under a quarter of its capacity takes in
+	//the values of its right neighbour, which is then dropped, when together they
+	//fill at most half a leaf.
+	template<typename T, typename C, size_t K>
+	void BlockSortedSet<T, C, K>::Shrink(size_t index){
+		Leaf* leaf = leaves_[index].get();
+		if(leaf->size_ == 0){
+			leaves_.erase(leaves_.begin() + index);
+			firsts_.erase(firsts_.begin() + index);
+			return;
+		}
+		firsts_[index] = leaf->values_[0];
+		if(leaf->size_ < K/4 && index + 1 < leaves_.size() && leaf->size_ + leaves_[index + 1]->size_ <= K/2){
+			Leaf* next = leaves_[index + 1].get();
+			std::move(next->values_.begin(), next->values_.begin() + next->size_, leaf->values_.begin() + leaf->size_);
+			leaf->size_ += next->size_;
+			leaves_.erase(leaves_.begin() + index + 1);
+			firsts_.erase(firsts_.begin() + index + 1);
+		}
+	}
+
+	//Calls f on values in order until it returns false.
+	template<typename T, typename C, size_t K>
+	template<typename F>
+	void BlockSortedSet<T, C, K>::ForEach(F f) const{
+		for(const auto& leaf: leaves_){
+			for(size_t i = 0; i < leaf->size_; ++i){
+				if(!f(leaf->values_[i])){
+					return;
+				}
+			}
+		}
+	}
+
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+namespace OrderBook{
+
+	//Bounded log that every consumer reads in full, after the disruptor. A producer
+	//claims the next position with one fetch_add and writes its entry into the slot
+	//of that position, so the position, not the order in which producers finish, is
+	//the entry's sequence number: seq is position + 1. Producers never wait for
+	//consumers; a new entry overwrites the oldest one in its slot. Each consumer owns
+	//a Cursor and reads the positions in order; a cursor that finds its slot already
+	//holding a later position was lapped and moves on to the oldest entry still in
+	//the log, counting what it missed, so the loss shows as a gap in seq. A producer
+	//that finds a later position already in its slot drops its entry, which is the
+	//same gap for every consumer. Each slot is a sequence lock over the position it
+	//holds, and its payload is stored as atomic words like in SeqLockTop, so a torn
+	//copy is caught by the check instead of being a data race. Claimed is the number
+	//of positions given out so far; it releases what producers did before claiming.
+	template<typename T>
+	class BroadcastLog{
+		static_assert(std::is_trivially_copyable_v<T>);
+
+	public:
+		//Reads the entries after seq; Seq() is the number of the last entry read.
+		class Cursor{
+		public:
+			explicit Cursor(uint64_t seq = 0): seq_(seq){}
+			uint64_t Seq() const { return seq_; }
+			uint64_t Missed() const { return missed_; }
+
+		private:
+			friend class BroadcastLog;
+			uint64_t seq_;
+			uint64_t missed_ = 0;
+		};
+
+		explicit BroadcastLog(size_t capacity);
+
+		uint64_t Publish(const T& value);
+		bool TryRead(Cursor& cursor, T& value) const;
+		uint64_t Claimed() const { return claimed_.load(std::memory_order_acquire); }
+
+	private:
+		static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1)/sizeof(uint64_t);
+		static constexpr size_t kCacheLine = 64;
+
+		//state_ is the seq held, shifted left by one, with the low bit set while a
+		//producer writes; 0 means never written.
+		struct Slot{
+			std::atomic<uint64_t> state_{0};
+			std::atomic<uint64_t> words_[kWords];
+		};
+
+		std::unique_ptr<Slot[]> slots_;
+		size_t mask_;
+		alignas(kCacheLine) std::atomic<uint64_t> claimed_{0};
+	};
+
+
+	template<typename T>
+	BroadcastLog<T>::BroadcastLog(size_t capacity){
+		size_t size = 2;
+		while(size < capacity){
+			size <<= 1;
+		}
+		slots_ = std::make_unique<Slot[]>(size);
+		mask_ = size - 1;
+	}
+
+	//Returns the seq of the entry.
+	template<typename T>
+	uint64_t BroadcastLog<T>::Publish(const T& value){
+		uint64_t seq = claimed_.fetch_add(1, std::memory_order_acq_rel) + 1;
+		Slot& slot = slots_[(seq - 1) & mask_];
+		uint64_t state = slot.state_.load(std::memory_order_relaxed);
+		for(;;){
+			if(state & 1){
+				std::this_thread::yield();
+				state = slot.state_.load(std::memory_order_relaxed);
+			}else if((state >> 1) > seq){
+				return seq;
+			}else if(slot.state_.compare_exchange_weak(state, (seq << 1) | 1, std::memory_order_acquire, std::memory_order_relaxed)){
+				break;
+			}
+		}
+		uint64_t words[kWords] = {};
+		std::memcpy(words, &value, sizeof(T));
+		for(size_t i = 0; i < kWords; ++i){
+			slot.words_[i].store(words[i], std::memory_order_release);
+		}
+		slot.state_.store(seq << 1, std::memory_order_release);
+		return seq;
+	}
+
+	//Copies the entry after the cursor into value and moves the cursor onto it; false
+	//while that entry is not written yet.
+	template<typename T>
+	bool BroadcastLog<T>::TryRead(Cursor& cursor, T& value) const{
+		uint64_t words[kWords];
+		for(;;){
+			uint64_t seq = cursor.seq_ + 1;
+			const Slot& slot = slots_[(seq - 1) & mask_];
+			uint64_t before = slot.state_.load(std::memory_order_acquire);
+			if((before >> 1) < seq || before == ((seq << 1) | 1)){
+				return false;
+			}
+			if((before >> 1) == seq){
+				for(size_t i = 0; i < kWords; ++i){
+					words[i] = slot.words_[i].load(std::memory_order_acquire);
+				}
+				if(slot.state_.load(std::memory_order_relaxed) == before){
+					std::memcpy(&value, words, sizeof(T));
+					cursor.seq_ = seq;
+					return true;
+				}
+				continue;
+			}
+			uint64_t claimed = Claimed();
+			uint64_t oldest = claimed > mask_ + 1 ? claimed - mask_ - 1 : 0;
+			uint64_t skip_to = std::max(seq, oldest);
+			cursor.missed_ += skip_to - cursor.seq_;
+			cursor.seq_ = skip_to;
+		}
+	}
+
+}
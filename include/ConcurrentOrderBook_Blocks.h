@@ -0,0 +1,107 @@
+#pragma once
+
+
+#include "Order.h"
+#include "BlockSortedSet.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <unordered_map>
+#include <utility>
+
+namespace OrderBook{
+
+	template<typename Comparator>
+	class BlockOrderedBookPrototype{
+	public:
+
+		using OrderBook = BlockSortedSet<Order, Comparator>;
+
+		bool Add(Order order);
+		bool Remove(uint64_t id);
+		std::list<Order> ShowTop10() const;
+		size_t ShowTopN(size_t n, std::span<Order> top) const;
+
+	private:
+		OrderBook order_book_;
+		std::unordered_map<uint64_t, Order> orders_;
+		mutable std::shared_mutex sh_mutex_;
+	};
+
+	class ConcurrentOrderBook_Blocks{
+	public:
+		bool Add(Order order);
+		bool Remove(uint64_t id);
+		bool Change(Order order);
+
+		struct BothTop10{
+			std::list<Order> top10_bids_;
+			std::list<Order> top10_asks_;
+		};
+
+		BothTop10 ShowTop10() const;
+		TopSizes ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const;
+		template<size_t N>
+		BothTop<N> ShowTop() const { return ShowTopOf<N>(*this); }
+
+	private:
+		BlockOrderedBookPrototype<std::less<Order>> asks_;
+		BlockOrderedBookPrototype<std::greater<Order>> bids_;
+	};
+
+
+
+	template<typename T>
+	bool BlockOrderedBookPrototype<T>::Add(Order order){
+		std::lock_guard lk(sh_mutex_);
+		if(orders_.contains(order.id_.val_) || !order_book_.Insert(order)){
+			return false;
+		}
+		orders_.emplace(order.id_.val_, order);
+		return true;
+	}
+
+	template<typename T>
+	bool BlockOrderedBookPrototype<T>::Remove(uint64_t id){
+		std::lock_guard lk(sh_mutex_);
+		auto It = orders_.find(id);
+		if(It == orders_.end()){
+			return false;
+		}
+		order_book_.Erase(It->second);
+		orders_.erase(It);
+		return true;
+	}
+
+	template<typename T>
+	std::list<Order> BlockOrderedBookPrototype<T>::ShowTop10() const{
+		std::list<Order> top10;
+		std::shared_lock lk(sh_mutex_);
+		order_book_.ForEach([&top10](const Order& order){
+			top10.push_back(order);
+			return top10.size() < 10;
+		});
+		return top10;
+	}
+
+	template<typename T>
+	size_t BlockOrderedBookPrototype<T>::ShowTopN(size_t n, std::span<Order> top) const{
+		size_t count = 0;
+		n = std::min(n, top.size());
+		if(n == 0){
+			return 0;
+		}
+		std::shared_lock lk(sh_mutex_);
+		order_book_.ForEach([&top, &count, n](const Order& order){
+			top[count++] = order;
+			return count < n;
+		});
+		return count;
+	}
+
+
+}
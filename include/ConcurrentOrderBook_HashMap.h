@@ -3,18 +3,45 @@
 #include "Order.h"
 #include "oneapi/tbb/concurrent_set.h"
 #include "oneapi/tbb/concurrent_hash_map.h"
+#include <algorithm>
 #include <utility>
 #include <memory>
 #include <set>
 #include <list>
 #include <mutex>
+#include <optional>
 #include <shared_mutex>
+#include <span>
 #include <vector>
 
 namespace OrderBook{
 
 	namespace tbb = oneapi::tbb;
-	
+
+	//Best orders of one side, maintained on every write. complete_ means the cache holds
+	//every order of the side; otherwise it holds the best top_.size() of them, and a
+	//reader that needs more than that has to rebuild it from the full side.
+	template<typename Comparator>
+	class IncrementalTop{
+	public:
+		static constexpr size_t kCapacity = 32;
+
+		void Add(const Order& order);
+		void Remove(const Order& order);
+		bool Show(std::list<Order>& top, size_t n) const;
+		bool Show(std::span<Order> top, size_t n, size_t& count) const;
+		void Reset(std::set<Order, Comparator> top, bool complete);
+
+	private:
+		std::set<Order, Comparator> top_;
+		bool complete_ = true;
+		mutable std::mutex mutex_;
+	};
+
+	//ShowTopN is served from the cache like ShowTop10. When the cache cannot answer and
+	//n fits into it, it is rebuilt the same way, so only the first such query pays the
+	//scan; a deeper query scans the side with a bounded heap kept in the caller's
+	//buffer, which never allocates.
 	class ConcurrentOrderBook_HashMap{
 	public:
 		using OrderStorage = tbb::concurrent_hash_map<uint64_t, Order>;
@@ -22,6 +49,10 @@ namespace OrderBook{
 		bool Add(Order order);
 		bool Remove(uint64_t id);
 		bool Change(Order order);
+		//A reduction is written into the stored order under its accessor, and only the
+		//top cache sees a remove and an add.
+		bool Modify(Order order);
+		bool Reduce(uint64_t id, size_t count);
 
 		struct BothTop10{
 			std::list<Order> top10_bids_;
@@ -29,15 +60,32 @@ namespace OrderBook{
 		};
 
 		BothTop10 ShowTop10() const;
+		TopSizes ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const;
+		template<size_t N>
+		BothTop<N> ShowTop() const { return ShowTopOf<N>(*this); }
 
 	private:
 
 		template<typename Comparator>
-		std::list<Order> FindTop10(std::vector<Order>& v) const;
+		std::set<Order, Comparator> FindTop(const OrderStorage& storage, size_t n) const;
+
+		template<typename Comparator>
+		std::list<Order> ShowTop(const OrderStorage& storage, IncrementalTop<Comparator>& cache,
+									std::shared_mutex& sh_mutex, size_t n) const;
+
+		template<typename Comparator>
+		size_t ShowTopN(const OrderStorage& storage, IncrementalTop<Comparator>& cache,
+						std::shared_mutex& sh_mutex, size_t n, std::span<Order> top) const;
+
+		template<typename Comparator>
+		static bool Shrink(OrderStorage& storage, IncrementalTop<Comparator>& cache, std::shared_mutex& sh_mutex,
+							uint64_t id, size_t count, std::optional<Price> price);
 		
 	private:
 		OrderStorage bids_;
 		OrderStorage asks_;
+		mutable IncrementalTop<std::greater<Order>> top_bids_;
+		mutable IncrementalTop<std::less<Order>> top_asks_;
 		mutable std::shared_mutex sh_mutex_b;
 		mutable std::shared_mutex sh_mutex_a;
 	
@@ -45,21 +93,140 @@ namespace OrderBook{
 	};
 
 	template<typename Comparator>
-	std::list<Order> ConcurrentOrderBook_HashMap::FindTop10(std::vector<Order>& v) const{
-		int size = static_cast<int>(v.size());
+	std::set<Order, Comparator> ConcurrentOrderBook_HashMap::FindTop(const OrderStorage& storage, size_t n) const{
 		Comparator Cmp;
 		std::set<Order, Comparator> res;
-		int i = 0;
-		for(; i < std::min(10, size); ++i){
-			res.insert(v[i]);
-		}
-		for(;i < size; ++i){
-			if(Cmp(v[i],*std::prev(res.end()))){
+		for(auto It = storage.begin(); It != storage.end(); ++It){
+			if(res.size() < n){
+				res.insert(It->second);
+			}else if(Cmp(It->second,*std::prev(res.end()))){
 				res.erase(std::prev(res.end()));
-				res.insert(v[i]);
+				res.insert(It->second);
+			}
+		}
+		return res;
+	}
+
+	//Served from the cache unless removals left it with fewer than n orders while the
+	//side still has more; only then the side is scanned under the exclusive lock.
+	template<typename Comparator>
+	std::list<Order> ConcurrentOrderBook_HashMap::ShowTop(const OrderStorage& storage, IncrementalTop<Comparator>& cache,
+															std::shared_mutex& sh_mutex, size_t n) const{
+		std::list<Order> top;
+		if(cache.Show(top, n)){
+			return top;
+		}
+		std::lock_guard lk(sh_mutex);
+		std::set<Order, Comparator> rebuilt = FindTop<Comparator>(storage, IncrementalTop<Comparator>::kCapacity);
+		bool complete = storage.size() <= IncrementalTop<Comparator>::kCapacity;
+		cache.Reset(std::move(rebuilt), complete);
+		cache.Show(top, n);
+		return top;
+	}
+
+
+	//Beyond the cache's capacity the first n entries of top hold a heap with the worst
+	//order kept at the front, which is turned into sorted order at the end.
+	template<typename Comparator>
+	size_t ConcurrentOrderBook_HashMap::ShowTopN(const OrderStorage& storage, IncrementalTop<Comparator>& cache,
+													std::shared_mutex& sh_mutex, size_t n, std::span<Order> top) const{
+		size_t count = 0;
+		n = std::min(n, top.size());
+		if(cache.Show(top, n, count)){
+			return count;
+		}
+		Comparator Cmp;
+		std::lock_guard lk(sh_mutex);
+		if(n <= IncrementalTop<Comparator>::kCapacity){
+			std::set<Order, Comparator> rebuilt = FindTop<Comparator>(storage, IncrementalTop<Comparator>::kCapacity);
+			bool complete = storage.size() <= IncrementalTop<Comparator>::kCapacity;
+			cache.Reset(std::move(rebuilt), complete);
+			cache.Show(top, n, count);
+			return count;
+		}
+		for(auto It = storage.begin(); It != storage.end(); ++It){
+			if(count < n){
+				top[count++] = It->second;
+				std::push_heap(top.begin(), top.begin() + count, Cmp);
+			}else if(Cmp(It->second, top[0])){
+				std::pop_heap(top.begin(), top.begin() + count, Cmp);
+				top[count - 1] = It->second;
+				std::push_heap(top.begin(), top.begin() + count, Cmp);
 			}
 		}
-		return {res.begin(), res.end()};
+		std::sort_heap(top.begin(), top.begin() + count, Cmp);
+		return count;
+	}
+
+	//Reduces the order with the given id to count if it rests in storage, at price
+	//when one is given.
+	template<typename Comparator>
+	bool ConcurrentOrderBook_HashMap::Shrink(OrderStorage& storage, IncrementalTop<Comparator>& cache, std::shared_mutex& sh_mutex,
+												uint64_t id, size_t count, std::optional<Price> price){
+		std::shared_lock lk(sh_mutex);
+		OrderStorage::accessor a;
+		if(!storage.find(a, id)){
+			return false;
+		}
+		Order& order = a->second;
+		if(count == 0 || count >= order.count_.val_ || (price && !(order.price_ == *price))){
+			return false;
+		}
+		cache.Remove(order);
+		order.count_.val_ = count;
+		cache.Add(order);
+		return true;
+	}
+
+
+	template<typename Comparator>
+	void IncrementalTop<Comparator>::Add(const Order& order){
+		Comparator Cmp;
+		std::lock_guard lk(mutex_);
+		if(complete_ || (!top_.empty() && Cmp(order, *std::prev(top_.end())))){
+			top_.insert(order);
+			if(top_.size() > kCapacity){
+				top_.erase(std::prev(top_.end()));
+				complete_ = false;
+			}
+		}
+	}
+
+	template<typename Comparator>
+	void IncrementalTop<Comparator>::Remove(const Order& order){
+		std::lock_guard lk(mutex_);
+		top_.erase(order);
+	}
+
+	template<typename Comparator>
+	bool IncrementalTop<Comparator>::Show(std::list<Order>& top, size_t n) const{
+		std::lock_guard lk(mutex_);
+		if(!complete_ && top_.size() < n){
+			return false;
+		}
+		for(auto It = top_.begin(); It != top_.end() && top.size() < n; ++It){
+			top.push_back(*It);
+		}
+		return true;
+	}
+
+	template<typename Comparator>
+	bool IncrementalTop<Comparator>::Show(std::span<Order> top, size_t n, size_t& count) const{
+		std::lock_guard lk(mutex_);
+		if(!complete_ && top_.size() < n){
+			return false;
+		}
+		for(auto It = top_.begin(); It != top_.end() && count < n; ++It){
+			top[count++] = *It;
+		}
+		return true;
+	}
+
+	template<typename Comparator>
+	void IncrementalTop<Comparator>::Reset(std::set<Order, Comparator> top, bool complete){
+		std::lock_guard lk(mutex_);
+		top_ = std::move(top);
+		complete_ = complete;
 	}
 
 }
@@ -2,20 +2,29 @@
 
 
 #include "Order.h"
+#include "OrderFeed.h"
+#include "SeqLockTop.h"
 #include "oneapi/tbb/concurrent_set.h"
 #include "oneapi/tbb/concurrent_hash_map.h"
+#include <algorithm>
 #include <utility>
 #include <memory>
+#include <array>
+#include <atomic>
 #include <list>
 #include <mutex>
+#include <optional>
 #include <shared_mutex>
+#include <span>
 #include <vector>
 
 namespace OrderBook{
 
 namespace tbb = oneapi::tbb;
 
-	template<typename Comparator>
+	//Snapshot switches the per-mutation top-10 publication on; shards of a larger book
+	//turn it off because only the book as a whole has a meaningful top.
+	template<typename Comparator, bool Snapshot = true>
 	class ConcurrentOrderedBookPrototype{
 	public:
 
@@ -26,12 +35,36 @@ namespace tbb = oneapi::tbb;
 		void Remove(OrderBook::iterator It);
 		Pair Change(OrderBook::iterator old_It, Order new_order);
 		std::list<Order> ShowTop10() const;
+		void ShowTop(std::list<Order>& top, size_t n) const;
+		size_t ShowTopN(size_t n, std::span<Order> top) const;
+		size_t ShowTop10Snapshot(std::array<Order, 10>& top10) const;
+		size_t CopyAfter(const std::optional<Order>& after, std::span<Order> orders) const;
+		bool Empty() const;
+
+	private:
+		void Publish();
 
 	private:
 		OrderBook order_book_;
 		mutable std::shared_mutex sh_mutex_;
+		SeqLockTop<10> top10_;
+		std::atomic<uint64_t> mutations_{0};
+		std::atomic<uint64_t> published_{0};
+		std::mutex publish_mutex_;
 	};
 
+	//EnableOrderEvents, called once before the book is shared, makes every change of a
+	//resting order publish an OrderEvent into a log of the given capacity: Add an ADD,
+	//Remove a CANCEL, Modify when it reduces in place and Reduce a MODIFY; Change and
+	//other amends are a CANCEL and an ADD. The book does no matching, so it never
+	//publishes an EXECUTE. Every consumer reads the whole log with DrainOrderEvents
+	//through its own OrderFeed::Cursor, in batches of up to max; a cursor built from
+	//seq starts after the event numbered seq. SnapshotOrders returns a cursor over all
+	//resting orders, bids first, that copies them in chunks under the shared lock of a
+	//side and resumes after the last order copied, so writers are held up for a chunk
+	//at a time. The walk is not atomic, but Seq() of the cursor is the number of
+	//events claimed before it started: storing the walked orders by id and then
+	//applying every event after OrderFeed::Cursor(Seq()) rebuilds the book exactly.
 	class ConcurrentOrderBook_HashSet{
 	public:
 		using OrderStorage_bids = tbb::concurrent_hash_map<uint64_t, typename tbb::concurrent_set<Order, std::greater<Order>>::iterator>;
@@ -39,66 +72,191 @@ namespace tbb = oneapi::tbb;
 		using Pair_bid = std::pair<typename tbb::concurrent_set<Order, std::greater<Order>>::iterator,bool>;
 		using Pair_ask = std::pair<typename tbb::concurrent_set<Order, std::less<Order>>::iterator,bool>;
 
+		class OrderCursor{
+		public:
+			uint64_t Seq() const { return seq_; }
+			size_t Next(std::span<Order> orders);
+
+		private:
+			friend class ConcurrentOrderBook_HashSet;
+			OrderCursor(const ConcurrentOrderBook_HashSet& book, uint64_t seq): book_(&book), seq_(seq){}
+
+			const ConcurrentOrderBook_HashSet* book_;
+			uint64_t seq_;
+			bool asks_ = false;
+			std::optional<Order> last_;
+		};
+
 		bool Add(Order order);
 
 		void Remove(uint64_t id);
 		bool Change(Order order);
+		//The size is part of the set key, so even a pure reduction requeues the order
+		//in its side, but under the accessor of its id: the id keeps its hash entry and
+		//only the stored iterator is replaced.
+		bool Modify(Order order);
+		bool Reduce(uint64_t id, size_t count);
 
 		struct BothTop10{
 			std::list<Order> top10_bids_;
 			std::list<Order> top10_asks_;
 		};
 
+		struct BothTop10Snapshot{
+			std::array<Order, 10> top10_bids_;
+			std::array<Order, 10> top10_asks_;
+			size_t bids_size_;
+			size_t asks_size_;
+		};
+
 		BothTop10 ShowTop10() const;
+		BothTop10Snapshot ShowTop10Snapshot() const;
+		TopSizes ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const;
+		template<size_t N>
+		BothTop<N> ShowTop() const { return ShowTopOf<N>(*this); }
+
+		void EnableOrderEvents(size_t capacity);
+		size_t DrainOrderEvents(OrderFeed::Cursor& cursor, std::vector<OrderEvent>& batch, size_t max) const;
+		OrderCursor SnapshotOrders() const;
+
+	private:
+		template<typename Storage, typename Side>
+		bool Shrink(Storage& storage, Side& side, uint64_t id, size_t count, std::optional<Price> price);
+		void Record(OrderEvent::Kind kind, const Order& order);
 
 	private:
 		OrderStorage_bids orders_bids_;
 		OrderStorage_asks orders_asks_;
 		ConcurrentOrderedBookPrototype<std::less<Order>> asks_;
 		ConcurrentOrderedBookPrototype<std::greater<Order>> bids_;
+		std::unique_ptr<OrderFeed> feed_;
 	};
 
 	
 	
-	template<typename T>
-	typename ConcurrentOrderedBookPrototype<T>::Pair
-		ConcurrentOrderedBookPrototype<T>::Add(Order order){
+	//Reduces the order with the given id to count if it rests on this side, at price
+	//when one is given, and records it as a MODIFY.
+	template<typename Storage, typename Side>
+	bool ConcurrentOrderBook_HashSet::Shrink(Storage& storage, Side& side, uint64_t id, size_t count, std::optional<Price> price){
+		typename Storage::accessor a;
+		if(!storage.find(a, id)){
+			return false;
+		}
+		Order order = *a->second;
+		if(count == 0 || count >= order.count_.val_ || (price && !(order.price_ == *price))){
+			return false;
+		}
+		order.count_.val_ = count;
+		auto result = side.Change(a->second, order);
+		a->second = result.first;
+		if(result.second){
+			Record(OrderEvent::Kind::MODIFY, order);
+		}
+		return result.second;
+	}
+
+	template<typename T, bool S>
+	typename ConcurrentOrderedBookPrototype<T, S>::Pair
+		ConcurrentOrderedBookPrototype<T, S>::Add(Order order){
 		Pair result;
 		{
 			std::shared_lock lk(sh_mutex_);
 			result = order_book_.insert(std::move(order));
 		}
+		if(S && result.second){
+			Publish();
+		}
 		return result;
 	}
 	
-	template<typename T>
-	void ConcurrentOrderedBookPrototype<T>::Remove(OrderBook::iterator It){
+	template<typename T, bool S>
+	void ConcurrentOrderedBookPrototype<T, S>::Remove(OrderBook::iterator It){
 		{
 			std::lock_guard lk(sh_mutex_);
 			order_book_.unsafe_erase(It);
 		}
+		if(S){
+			Publish();
+		}
 	}
 
-	template<typename T>
-	ConcurrentOrderedBookPrototype<T>::Pair
-		ConcurrentOrderedBookPrototype<T>::Change(OrderBook::iterator old_It, Order new_order){
+	template<typename T, bool S>
+	ConcurrentOrderedBookPrototype<T, S>::Pair
+		ConcurrentOrderedBookPrototype<T, S>::Change(OrderBook::iterator old_It, Order new_order){
 		Remove(old_It);
 		Pair result = Add(std::move(new_order));
 		return result;
 	}
 
-	template<typename T>
-	std::list<Order> ConcurrentOrderedBookPrototype<T>::ShowTop10() const{
+	template<typename T, bool S>
+	std::list<Order> ConcurrentOrderedBookPrototype<T, S>::ShowTop10() const{
 		std::list<Order> top10;
-		int counter = 0;
+		ShowTop(top10, 10);
+		return top10;
+	}
+
+	template<typename T, bool S>
+	void ConcurrentOrderedBookPrototype<T, S>::ShowTop(std::list<Order>& top, size_t n) const{
+		std::shared_lock lk(sh_mutex_);
+		for(auto It = order_book_.begin(); It != order_book_.end() && top.size() < n; ++It){
+			top.push_back(*It);
+		}
+	}
+
+	template<typename T, bool S>
+	size_t ConcurrentOrderedBookPrototype<T, S>::ShowTopN(size_t n, std::span<Order> top) const{
+		size_t count = 0;
+		n = std::min(n, top.size());
+		std::shared_lock lk(sh_mutex_);
+		for(auto It = order_book_.begin(); It != order_book_.end() && count < n; ++It){
+			top[count++] = *It;
+		}
+		return count;
+	}
+
+	//Copies the orders that follow after, or the first ones when there is none, into
+	//orders and returns how many. after need not rest in the side any more.
+	template<typename T, bool S>
+	size_t ConcurrentOrderedBookPrototype<T, S>::CopyAfter(const std::optional<Order>& after, std::span<Order> orders) const{
+		size_t count = 0;
+		std::shared_lock lk(sh_mutex_);
+		auto It = after ? order_book_.upper_bound(*after) : order_book_.begin();
+		for(; It != order_book_.end() && count < orders.size(); ++It){
+			orders[count++] = *It;
+		}
+		return count;
+	}
+
+	template<typename T, bool S>
+	bool ConcurrentOrderedBookPrototype<T, S>::Empty() const{
+		return order_book_.empty();
+	}
+
+	template<typename T, bool S>
+	size_t ConcurrentOrderedBookPrototype<T, S>::ShowTop10Snapshot(std::array<Order, 10>& top10) const{
+		return top10_.Read(top10);
+	}
+
+	//Called after a change. Writers count their changes in mutations_ and published_
+	//is the count the last publication covers, so a writer republishes only if no
+	//publication started after its change, and at most once: every change counted
+	//before a publication reads mutations_ is already in the book it copies.
+	template<typename T, bool S>
+	void ConcurrentOrderedBookPrototype<T, S>::Publish(){
+		uint64_t mutation = mutations_.fetch_add(1) + 1;
+		if(published_.load() >= mutation){
+			return;
+		}
+		std::lock_guard publish_lk(publish_mutex_);
+		if(published_.load() >= mutation){
+			return;
+		}
+		uint64_t covered = mutations_.load();
 		{
 			std::shared_lock lk(sh_mutex_);
-			for(auto It = order_book_.begin();
-					It != order_book_.end() && counter < 10; ++It, ++counter){
-				top10.push_back(*It);
-			}
+			top10_.Publish(order_book_.begin(), order_book_.end());
 		}
-		return top10;
+		published_.store(covered);
 	}
 
 
@@ -0,0 +1,169 @@
+#pragma once
+
+
+#include "LevelFeed.h"
+#include "Order.h"
+#include "PriceLevel.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace OrderBook{
+
+	//One side of the book as a tree of aggregated price levels: the tree holds one
+	//node per distinct price, the orders of a level are queued in its PriceLevel.
+	//With a feed set, every change of a level's size is published to it.
+	template<template<typename> class Comparator>
+	class LevelMapPrototype{
+	public:
+		using Levels = std::map<size_t, PriceLevel, Comparator<size_t>>;
+
+		bool Add(Order order);
+		bool Remove(uint64_t id);
+		std::list<Order> ShowTop10() const;
+		size_t ShowTopN(size_t n, std::span<Order> top) const;
+		void SetFeed(LevelFeed* feed);
+
+		//Unlocked, for a caller that holds Mutex(), possibly together with the
+		//opposite side's.
+		std::mutex& Mutex() const { return mutex_; }
+		std::list<LevelInfo> TopLevels(size_t n) const;
+
+	private:
+		void Publish(size_t tick, size_t quantity);
+
+	private:
+		OrderPool pool_;
+		std::unordered_map<uint64_t, uint32_t> slots_;
+		Levels levels_;
+		LevelFeed* feed_ = nullptr;
+		mutable std::mutex mutex_;
+	};
+
+	class ConcurrentOrderBook_LevelMap{
+	public:
+		bool Add(Order order);
+		bool Remove(uint64_t id);
+		bool Change(Order order);
+
+		struct BothTop10{
+			std::list<Order> top10_bids_;
+			std::list<Order> top10_asks_;
+		};
+
+		struct BothTopLevels{
+			std::list<LevelInfo> bids_;
+			std::list<LevelInfo> asks_;
+			uint64_t seq_;
+		};
+
+		BothTop10 ShowTop10() const;
+		BothTopLevels ShowTopLevels(size_t n) const;
+		TopSizes ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const;
+		template<size_t N>
+		BothTop<N> ShowTop() const { return ShowTopOf<N>(*this); }
+
+		void EnableLevelUpdates(size_t capacity);
+		size_t DrainLevelUpdates(LevelFeed::Cursor& cursor, std::vector<LevelUpdate>& batch, size_t max) const;
+
+	private:
+		LevelMapPrototype<std::greater> bids_;
+		LevelMapPrototype<std::less> asks_;
+		std::unique_ptr<LevelFeed> feed_;
+	};
+
+
+
+	template<template<typename> class T>
+	bool LevelMapPrototype<T>::Add(Order order){
+		uint64_t id = order.id_.val_;
+		size_t tick = ToTicks(order.price_);
+		std::lock_guard lk(mutex_);
+		if(slots_.contains(id)){
+			return false;
+		}
+		uint32_t slot = pool_.Allocate(std::move(order));
+		PriceLevel& level = levels_[tick];
+		level.Insert(pool_, slot, T<Order>{});
+		slots_.emplace(id, slot);
+		Publish(tick, level.quantity_);
+		return true;
+	}
+
+	template<template<typename> class T>
+	bool LevelMapPrototype<T>::Remove(uint64_t id){
+		std::lock_guard lk(mutex_);
+		auto It = slots_.find(id);
+		if(It == slots_.end()){
+			return false;
+		}
+		uint32_t slot = It->second;
+		auto level = levels_.find(ToTicks(pool_[slot].order_.price_));
+		level->second.Unlink(pool_, slot);
+		Publish(level->first, level->second.quantity_);
+		if(level->second.Empty()){
+			levels_.erase(level);
+		}
+		pool_.Free(slot);
+		slots_.erase(It);
+		return true;
+	}
+
+	template<template<typename> class T>
+	void LevelMapPrototype<T>::SetFeed(LevelFeed* feed){
+		std::lock_guard lk(mutex_);
+		feed_ = feed;
+	}
+
+	template<template<typename> class T>
+	void LevelMapPrototype<T>::Publish(size_t tick, size_t quantity){
+		if(feed_){
+			feed_->Publish(T<size_t>{}(0, 1) ? Type::SELL : Type::BUY, tick, quantity);
+		}
+	}
+
+	template<template<typename> class T>
+	std::list<Order> LevelMapPrototype<T>::ShowTop10() const{
+		std::list<Order> top10;
+		size_t counter = 0;
+		std::lock_guard lk(mutex_);
+		for(auto It = levels_.begin(); It != levels_.end() && counter < 10; ++It){
+			for(uint32_t slot = It->second.head_; slot != OrderPool::kNull && counter < 10; slot = pool_[slot].next_, ++counter){
+				top10.push_back(pool_[slot].order_);
+			}
+		}
+		return top10;
+	}
+
+	template<template<typename> class T>
+	size_t LevelMapPrototype<T>::ShowTopN(size_t n, std::span<Order> top) const{
+		size_t count = 0;
+		n = std::min(n, top.size());
+		std::lock_guard lk(mutex_);
+		for(auto It = levels_.begin(); It != levels_.end() && count < n; ++It){
+			for(uint32_t slot = It->second.head_; slot != OrderPool::kNull && count < n; slot = pool_[slot].next_){
+				top[count++] = pool_[slot].order_;
+			}
+		}
+		return count;
+	}
+
+	template<template<typename> class T>
+	std::list<LevelInfo> LevelMapPrototype<T>::TopLevels(size_t n) const{
+		std::list<LevelInfo> top;
+		for(auto It = levels_.begin(); It != levels_.end() && top.size() < n; ++It){
+			top.push_back({FromTicks(It->first), Count(It->second.quantity_), It->second.size_});
+		}
+		return top;
+	}
+
+}
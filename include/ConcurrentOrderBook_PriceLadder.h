@@ -0,0 +1,803 @@
+#pragma once
+
+
+#include "FenwickTree.h"
+#include "LevelFeed.h"
+#include "OccupancyBitmap.h"
+#include "Order.h"
+#include "PriceLevel.h"
+#include "TimerWheel.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace OrderBook{
+
+	//Cost of taking quantity from one side at once: quantity_ is the part the side can
+	//fill, worst_ the last price reached, notional_ the sum of count times price in
+	//ticks and vwap_ the average price.
+	struct FillCost{
+		Count quantity_ = Count(0);
+		Price worst_ = Price(0, 0);
+		uint64_t notional_ = 0;
+		double vwap_ = 0;
+	};
+
+	//One side of the book as an array of price levels indexed by tick. Levels are
+	//allocated in pages of kPageSize ticks, so a sparse side costs one pointer per
+	//empty page. Comparator<size_t> tells which of two ticks is the better price and
+	//Index keeps one occupancy bit per tick to find the next non-empty level.
+	//With time priority every accepted order joins the tail of its level, so a level
+	//is a FIFO queue in the order the side accepted its orders. An iceberg rests with
+	//its peak displayed and the rest of its size hidden in its node.
+	//Every change of a level's size also goes into two Fenwick trees with one node
+	//per page, one of quantities and one of quantity times price. The trees cover a
+	//power-of-two range of pages and are rebuilt at twice the size when a level
+	//outside it changes. Orders with an expiry are also scheduled in a timer wheel,
+	//which a side allocates with its first such order.
+	template<template<typename> class Comparator, typename Index>
+	class PriceLadderPrototype{
+	public:
+		explicit PriceLadderPrototype(bool time_priority = false);
+
+		bool Add(Order order, const OrderTerms& terms = {});
+		bool Remove(uint64_t id);
+		//Shrinks a resting order without leaving its level: under time priority it
+		//keeps its place, otherwise it is relinked inside the level by its new size.
+		//For an iceberg the count is the displayed and hidden size together, taken off
+		//the reserve first.
+		bool Reduce(uint64_t id, size_t count, std::optional<Price> price = std::nullopt);
+		//Collects what the timer wheel yields up to now and removes it under one lock;
+		//entries of orders that have gone or were replaced meanwhile are recognised by
+		//their id and expiry and skipped.
+		size_t Expire(uint64_t now);
+		std::list<Order> ShowTop10() const;
+		size_t ShowTopN(size_t n, std::span<Order> top) const;
+		//Both take O(log pages) in the Fenwick trees plus a walk of at most one page
+		//instead of a walk over every level.
+		size_t QuantityUpTo(size_t tick) const;
+		FillCost CostOf(size_t quantity) const;
+		std::optional<OrderTerms> TermsOf(uint64_t id) const;
+		//With a feed set, every change of a level's displayed size is published to it,
+		//once per level touched by an operation.
+		void SetFeed(LevelFeed* feed);
+
+		//Unlocked operations for a caller that holds Mutex(), possibly together
+		//with the opposite side's.
+		std::mutex& Mutex() const { return mutex_; }
+		std::list<LevelInfo> TopLevels(size_t n) const;
+		bool Contains(uint64_t id) const { return slots_.contains(id); }
+		uint32_t OwnerOf(uint64_t id) const { return pool_[slots_.at(id)].order_.owner_; }
+		size_t BestTick() const { return best_tick_; }
+		size_t DepthAt(size_t tick) const;
+		bool Rest(Order order, const OrderTerms& terms = {});
+		//The FOK check: reads the side without any writes.
+		bool Covers(const Order& taker, SelfTrade self_trade) const;
+		//When the displayed slice of an iceberg is executed the next one is cut from
+		//the reserve and the order is requeued inside its level in place.
+		template<typename FillSink>
+		void Take(Order& taker, FillSink& sink, SelfTrade self_trade);
+
+		static constexpr size_t kNoTick = SIZE_MAX;
+
+	private:
+		static constexpr size_t kPageBits = 6;
+		static constexpr size_t kPageSize = size_t{1} << kPageBits;
+		static constexpr bool kAscending = Comparator<size_t>{}(0, 1);
+
+		//indexed_ is the size each level has in the page's Fenwick node.
+		struct Page{
+			std::array<PriceLevel, kPageSize> levels_;
+			std::array<size_t, kPageSize> indexed_{};
+		};
+
+		PriceLevel& Level(size_t tick);
+		const PriceLevel& LevelAt(size_t tick) const;
+		void Enqueue(PriceLevel& level, uint32_t slot);
+		//For a taker that can absorb a whole level: every maker is filled in full,
+		//dropped from slots_ and returned to the pool, and the level is reset at once
+		//instead of being unlinked order by order.
+		template<typename FillSink>
+		void Sweep(PriceLevel& level, Order& taker, FillSink& sink);
+		size_t NextOccupied(size_t tick) const;
+		size_t Worse(size_t tick) const;
+		void Erase(std::unordered_map<uint64_t, uint32_t>::iterator It);
+		void LevelChanged(size_t tick);
+		void Regrow(size_t page);
+		const Page* PageAt(size_t page) const;
+
+	private:
+		OrderPool pool_;
+		std::unordered_map<uint64_t, uint32_t> slots_;
+		std::unique_ptr<TimerWheel<uint64_t>> expiries_;
+		LevelFeed* feed_ = nullptr;
+		FenwickTree quantities_;
+		FenwickTree notionals_;
+		size_t index_base_ = 0;
+		std::vector<std::unique_ptr<Page>> pages_;
+		size_t first_page_ = 0;
+		size_t best_tick_ = kNoTick;
+		Index occupied_;
+		bool time_priority_;
+		mutable std::mutex mutex_;
+	};
+
+	//Two PriceLadderPrototype sides, each with its own lock. Index is the occupancy
+	//bitmap of both: a single level scans one word per page, three levels find the
+	//next price in a few countr_zero steps. Time priority ranks orders of one price by
+	//arrival instead of by size and id.
+	template<typename Index>
+	class PriceLadderBook{
+	public:
+		//self_trade is the self-trade prevention rule; the check is one comparison of
+		//the owner_ tags of the two orders per fill.
+		explicit PriceLadderBook(bool matching = false, bool time_priority = false, SelfTrade self_trade = SelfTrade::NONE);
+
+		//In matching mode Add first executes the order against the opposite side,
+		//holding the locks of both sides, or only the opposite side's for a MARKET
+		//order, and rests only the remainder; fills are passed to the sink one by one
+		//(Add without a sink drops them). An IOC remainder is dropped and a FOK order
+		//is first checked against the opposite liquidity without any writes. Add
+		//returns false if the order was neither executed nor rested.
+		bool Add(Order order, OrderTerms terms = {});
+		template<typename FillSink>
+		bool Add(Order order, FillSink&& sink);
+		template<typename FillSink>
+		bool Add(Order order, OrderTerms terms, FillSink&& sink);
+		//Takes the locks once for all orders and returns how many were accepted.
+		template<typename FillSink>
+		size_t AddBatch(std::vector<std::pair<Order, OrderTerms>>& orders, FillSink&& sink);
+		bool Remove(uint64_t id);
+		bool Change(Order order, OrderTerms terms = {});
+		//What is not a reduction goes through Change with the iceberg peak and expiry
+		//the order rests with.
+		bool Modify(Order order);
+		bool Reduce(uint64_t id, size_t count);
+		//Executes an order into fills, which the caller keeps between calls so that a
+		//sweep does not allocate.
+		size_t Sweep(Order order, std::vector<Fill>& fills);
+		//With a band of n ticks, no order executes more than n ticks beyond the
+		//opposite best price: a market order is limited there and a limit order beyond
+		//it is cut back to it, and either drops what is left. 0 turns the band off.
+		void SetProtectionBand(size_t ticks);
+		//For a taker of the given type: the displayed and hidden quantity it would meet
+		//up to limit, and what taking quantity would cost.
+		size_t QuantityUpTo(Type type, Price limit) const;
+		FillCost CostOf(Type type, size_t quantity) const;
+		//Removes every order whose expiry is not later than now and returns how many it
+		//removed; now is in whatever units the caller uses for expiries.
+		size_t ExpireOrders(uint64_t now);
+		void EnableLevelUpdates(size_t capacity);
+		size_t DrainLevelUpdates(LevelFeed::Cursor& cursor, std::vector<LevelUpdate>& batch, size_t max) const;
+		//From here a matching book rests every order without matching (IOC, FOK and
+		//MARKET orders are rejected) until Uncross.
+		void StartAuction();
+		//Runs on any book: finds the price that executes the most volume, then the one
+		//with the smallest imbalance, then the lowest, executes everything that crosses
+		//at that price in priority order and returns the fills, with the ask as maker_.
+		//Both sides are executed before they are paired, so under any self_trade rule
+		//a pair of orders with the same owner_ takes the size off both without a fill.
+		//The cumulative volume curves over the crossed range of levels are built with
+		//tbb::parallel_scan.
+		std::vector<Fill> Uncross();
+
+		struct BothTop10{
+			std::list<Order> top10_bids_;
+			std::list<Order> top10_asks_;
+		};
+
+		struct BothTopLevels{
+			std::list<LevelInfo> bids_;
+			std::list<LevelInfo> asks_;
+			uint64_t seq_;
+		};
+
+		BothTop10 ShowTop10() const;
+		BothTopLevels ShowTopLevels(size_t n) const;
+		TopSizes ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const;
+		template<size_t N>
+		BothTop<N> ShowTop() const { return ShowTopOf<N>(*this); }
+
+	private:
+		template<typename Own, typename Opposite, typename FillSink>
+		bool Match(Own& own, Opposite& opposite, Order order, const OrderTerms& terms, FillSink& sink);
+
+	private:
+		PriceLadderPrototype<std::greater, Index> bids_;
+		PriceLadderPrototype<std::less, Index> asks_;
+		bool matching_;
+		SelfTrade self_trade_;
+		bool auction_ = false;
+		size_t band_ = 0;
+		std::unique_ptr<LevelFeed> feed_;
+	};
+
+	using ConcurrentOrderBook_PriceLadder = PriceLadderBook<OccupancyBitmap<1>>;
+	using ConcurrentOrderBook_BitmapLadder = PriceLadderBook<OccupancyBitmap<3>>;
+
+
+
+	template<typename I>
+	template<typename FillSink>
+	bool PriceLadderBook<I>::Add(Order order, FillSink&& sink){
+		return Add(std::move(order), OrderTerms{}, sink);
+	}
+
+	template<typename I>
+	template<typename FillSink>
+	bool PriceLadderBook<I>::Add(Order order, OrderTerms terms, FillSink&& sink){
+		if(!matching_){
+			return Add(std::move(order), terms);
+		}
+		if((order.flags_ & MARKET) && order.type_ == Type::BUY){
+			std::lock_guard lk(asks_.Mutex());
+			return Match(bids_, asks_, std::move(order), terms, sink);
+		}else if(order.flags_ & MARKET){
+			std::lock_guard lk(bids_.Mutex());
+			return Match(asks_, bids_, std::move(order), terms, sink);
+		}
+		std::scoped_lock lk(bids_.Mutex(), asks_.Mutex());
+		if(order.type_ == Type::BUY){
+			return Match(bids_, asks_, std::move(order), terms, sink);
+		}else if(order.type_ == Type::SELL){
+			return Match(asks_, bids_, std::move(order), terms, sink);
+		}
+		return false;
+	}
+
+	template<typename I>
+	template<typename FillSink>
+	size_t PriceLadderBook<I>::AddBatch(std::vector<std::pair<Order, OrderTerms>>& orders, FillSink&& sink){
+		size_t accepted = 0;
+		if(!matching_){
+			for(auto& [order, terms]: orders){
+				accepted += Add(std::move(order), terms);
+			}
+			return accepted;
+		}
+		std::scoped_lock lk(bids_.Mutex(), asks_.Mutex());
+		for(auto& [order, terms]: orders){
+			if(order.type_ == Type::BUY){
+				accepted += Match(bids_, asks_, std::move(order), terms, sink);
+			}else if(order.type_ == Type::SELL){
+				accepted += Match(asks_, bids_, std::move(order), terms, sink);
+			}
+		}
+		return accepted;
+	}
+
+	//Called with the locks of both sides held, or only the opposite side's for a
+	//MARKET order, which never touches its own side.
+	template<typename I>
+	template<typename Own, typename Opposite, typename FillSink>
+	bool PriceLadderBook<I>::Match(Own& own, Opposite& opposite, Order order, const OrderTerms& terms, FillSink& sink){
+		bool market = order.flags_ & MARKET;
+		if(auction_){
+			return !(order.flags_ & (IOC | FOK | MARKET)) && own.Rest(std::move(order), terms);
+		}
+		size_t best = opposite.BestTick();
+		if(market && best == opposite.kNoTick){
+			return false;
+		}
+		if((market || band_ != 0) && best != opposite.kNoTick){
+			size_t limit = ToTicks(order.price_);
+			size_t edge;
+			if(order.type_ == Type::BUY){
+				edge = band_ == 0 ? SIZE_MAX : best + band_;
+			}else{
+				edge = band_ == 0 || best < band_ ? 0 : best - band_;
+			}
+			bool beyond = order.type_ == Type::BUY ? limit > edge : limit < edge;
+			if(market || beyond){
+				order.price_ = FromTicks(edge);
+				order.flags_ |= IOC;
+			}
+		}
+		if((!market && own.Contains(order.id_.val_)) || ((order.flags_ & FOK) && !opposite.Covers(order, self_trade_))){
+			return false;
+		}
+		size_t count = order.count_.val_;
+		opposite.Take(order, sink, self_trade_);
+		if(order.count_.val_ == 0 || (order.flags_ & (IOC | FOK))){
+			return order.count_.val_ != count;
+		}
+		return own.Rest(std::move(order), terms);
+	}
+
+
+
+	template<template<typename> class T, typename I>
+	PriceLadderPrototype<T, I>::PriceLadderPrototype(bool time_priority): time_priority_(time_priority){}
+
+	template<template<typename> class T, typename I>
+	bool PriceLadderPrototype<T, I>::Add(Order order, const OrderTerms& terms){
+		std::lock_guard lk(mutex_);
+		return Rest(std::move(order), terms);
+	}
+
+	template<template<typename> class T, typename I>
+	bool PriceLadderPrototype<T, I>::Rest(Order order, const OrderTerms& terms){
+		uint64_t id = order.id_.val_;
+		size_t tick = ToTicks(order.price_);
+		if(slots_.contains(id)){
+			return false;
+		}
+		size_t hidden = 0;
+		if(terms.peak_ != 0 && order.count_.val_ > terms.peak_){
+			hidden = order.count_.val_ - terms.peak_;
+			order.count_.val_ = terms.peak_;
+		}
+		if(terms.expiry_ != 0){
+			if(!expiries_){
+				expiries_ = std::make_unique<TimerWheel<uint64_t>>();
+			}
+			expiries_->Schedule(terms.expiry_, id);
+		}
+		uint32_t slot = pool_.Allocate(std::move(order));
+		pool_[slot].peak_ = terms.peak_;
+		pool_[slot].hidden_ = hidden;
+		pool_[slot].expiry_ = terms.expiry_;
+		PriceLevel& level = Level(tick);
+		if(level.Empty()){
+			occupied_.Set(tick);
+		}
+		Enqueue(level, slot);
+		slots_.emplace(id, slot);
+		if(best_tick_ == kNoTick || T<size_t>{}(tick, best_tick_)){
+			best_tick_ = tick;
+		}
+		LevelChanged(tick);
+		return true;
+	}
+
+	//Whether the levels up to the taker's limit hold its whole size. Sums level totals
+	//and stops at the first level that completes it. Under self-trade prevention the
+	//taker's own orders do not count, so its levels are walked order by order, and
+	//with CANCEL_NEWEST nothing behind the first own order counts either.
+	template<template<typename> class T, typename I>
+	bool PriceLadderPrototype<T, I>::Covers(const Order& taker, SelfTrade self_trade) const{
+		size_t limit = ToTicks(taker.price_);
+		size_t available = 0;
+		bool own = self_trade != SelfTrade::NONE && taker.owner_ != 0;
+		for(size_t tick = best_tick_; tick != kNoTick && !T<size_t>{}(limit, tick); tick = NextOccupied(Worse(tick))){
+			const PriceLevel& level = LevelAt(tick);
+			if(!own){
+				available += level.quantity_ + level.hidden_;
+			}
+			for(uint32_t slot = own ? level.head_ : OrderPool::kNull; slot != OrderPool::kNull; slot = pool_[slot].next_){
+				const Order& maker = pool_[slot].order_;
+				if(maker.owner_ == taker.owner_){
+					if(self_trade == SelfTrade::CANCEL_NEWEST){
+						return false;
+					}
+					continue;
+				}
+				available += maker.count_.val_ + pool_[slot].hidden_;
+				if(available >= taker.count_.val_){
+					return true;
+				}
+			}
+			if(available >= taker.count_.val_){
+				return true;
+			}
+		}
+		return taker.count_.val_ == 0;
+	}
+
+	//Executes taker against this side from the best price for as long as the price
+	//does not pass the taker's limit. A partially filled maker keeps its arrival place
+	//under time priority and is re-ranked by its new size otherwise; an iceberg whose
+	//slice is used up is refilled and requeued without leaving the pool or slots_.
+	//A maker of the taker's own account is handled by self_trade instead of filled;
+	//a decrement goes through the same bookkeeping as a fill, only without the sink.
+	template<template<typename> class T, typename I>
+	template<typename FillSink>
+	void PriceLadderPrototype<T, I>::Take(Order& taker, FillSink& sink, SelfTrade self_trade){
+		size_t limit = ToTicks(taker.price_);
+		uint32_t owner = self_trade == SelfTrade::NONE ? 0 : taker.owner_;
+		while(taker.count_.val_ != 0 && best_tick_ != kNoTick && !T<size_t>{}(limit, best_tick_)){
+			size_t tick = best_tick_;
+			PriceLevel& level = Level(tick);
+			if(owner == 0 && taker.count_.val_ >= level.quantity_ + level.hidden_){
+				Sweep(level, taker, sink);
+			}
+			while(taker.count_.val_ != 0 && !level.Empty()){
+				uint32_t slot = level.head_;
+				OrderNode& node = pool_[slot];
+				Order& maker = node.order_;
+				bool self = owner != 0 && maker.owner_ == owner;
+				if(self && self_trade == SelfTrade::CANCEL_NEWEST){
+					taker.count_.val_ = 0;
+					break;
+				}
+				if(self && self_trade == SelfTrade::CANCEL_OLDEST){
+					Erase(slots_.find(maker.id_.val_));
+					continue;
+				}
+				size_t count = std::min(taker.count_.val_, maker.count_.val_);
+				if(!self){
+					sink(Fill{maker.id_, taker.id_, maker.price_, Count(count)});
+				}
+				taker.count_.val_ -= count;
+				if(count == maker.count_.val_ && node.hidden_ != 0){
+					level.Unlink(pool_, slot);
+					maker.count_.val_ = std::min(node.peak_, node.hidden_);
+					node.hidden_ -= maker.count_.val_;
+					Enqueue(level, slot);
+				}else if(count == maker.count_.val_){
+					level.Unlink(pool_, slot);
+					slots_.erase(maker.id_.val_);
+					pool_.Free(slot);
+				}else if(time_priority_){
+					maker.count_.val_ -= count;
+					level.quantity_ -= count;
+				}else{
+					level.Unlink(pool_, slot);
+					maker.count_.val_ -= count;
+					level.Insert(pool_, slot, T<Order>{});
+				}
+			}
+			LevelChanged(tick);
+			if(level.Empty()){
+				occupied_.Clear(tick);
+				best_tick_ = NextOccupied(Worse(tick));
+			}
+		}
+	}
+
+	//Fills every maker of level in full against taker and empties the level.
+	template<template<typename> class T, typename I>
+	template<typename FillSink>
+	void PriceLadderPrototype<T, I>::Sweep(PriceLevel& level, Order& taker, FillSink& sink){
+		for(uint32_t slot = level.head_; slot != OrderPool::kNull;){
+			uint32_t next = pool_[slot].next_;
+			const Order& maker = pool_[slot].order_;
+			sink(Fill{maker.id_, taker.id_, maker.price_, Count(maker.count_.val_ + pool_[slot].hidden_)});
+			slots_.erase(maker.id_.val_);
+			pool_.Free(slot);
+			slot = next;
+		}
+		taker.count_.val_ -= level.quantity_ + level.hidden_;
+		level = PriceLevel{};
+	}
+
+	//Links slot into level by the side's priority rule; under time priority an order
+	//ranks behind every order already queued, so it goes straight to the tail.
+	template<template<typename> class T, typename I>
+	void PriceLadderPrototype<T, I>::Enqueue(PriceLevel& level, uint32_t slot){
+		if(time_priority_){
+			level.Insert(pool_, slot, [](const Order&, const Order&){ return false; });
+		}else{
+			level.Insert(pool_, slot, T<Order>{});
+		}
+	}
+
+	template<template<typename> class T, typename I>
+	bool PriceLadderPrototype<T, I>::Remove(uint64_t id){
+		std::lock_guard lk(mutex_);
+		auto It = slots_.find(id);
+		if(It == slots_.end()){
+			return false;
+		}
+		Erase(It);
+		return true;
+	}
+
+	template<template<typename> class T, typename I>
+	bool PriceLadderPrototype<T, I>::Reduce(uint64_t id, size_t count, std::optional<Price> price){
+		std::lock_guard lk(mutex_);
+		auto It = slots_.find(id);
+		if(It == slots_.end()){
+			return false;
+		}
+		uint32_t slot = It->second;
+		OrderNode& node = pool_[slot];
+		Order& order = node.order_;
+		size_t total = order.count_.val_ + node.hidden_;
+		if(count == 0 || count >= total || (price && !(order.price_ == *price))){
+			return false;
+		}
+		PriceLevel& level = Level(ToTicks(order.price_));
+		size_t hidden = count > order.count_.val_ ? count - order.count_.val_ : 0;
+		size_t shown = count - hidden;
+		if(time_priority_ || shown == order.count_.val_){
+			level.quantity_ -= order.count_.val_ - shown;
+			level.hidden_ -= node.hidden_ - hidden;
+			order.count_.val_ = shown;
+			node.hidden_ = hidden;
+		}else{
+			level.Unlink(pool_, slot);
+			order.count_.val_ = shown;
+			node.hidden_ = hidden;
+			level.Insert(pool_, slot, T<Order>{});
+		}
+		LevelChanged(ToTicks(order.price_));
+		return true;
+	}
+
+	template<template<typename> class T, typename I>
+	size_t PriceLadderPrototype<T, I>::Expire(uint64_t now){
+		size_t expired = 0;
+		std::lock_guard lk(mutex_);
+		if(!expiries_){
+			return 0;
+		}
+		expiries_->Advance(now, [this, now, &expired](uint64_t id){
+			auto It = slots_.find(id);
+			if(It != slots_.end()){
+				uint64_t expiry = pool_[It->second].expiry_;
+				if(expiry != 0 && expiry <= now){
+					Erase(It);
+					++expired;
+				}
+			}
+		});
+		return expired;
+	}
+
+	template<template<typename> class T, typename I>
+	void PriceLadderPrototype<T, I>::Erase(std::unordered_map<uint64_t, uint32_t>::iterator It){
+		uint32_t slot = It->second;
+		size_t tick = ToTicks(pool_[slot].order_.price_);
+		PriceLevel& level = Level(tick);
+		level.Unlink(pool_, slot);
+		if(level.Empty()){
+			occupied_.Clear(tick);
+			if(tick == best_tick_){
+				best_tick_ = NextOccupied(Worse(tick));
+			}
+		}
+		pool_.Free(slot);
+		slots_.erase(It);
+		LevelChanged(tick);
+	}
+
+	//The iceberg peak and expiry the order with the given id rests with.
+	template<template<typename> class T, typename I>
+	std::optional<OrderTerms> PriceLadderPrototype<T, I>::TermsOf(uint64_t id) const{
+		std::lock_guard lk(mutex_);
+		auto It = slots_.find(id);
+		if(It == slots_.end()){
+			return std::nullopt;
+		}
+		OrderTerms terms;
+		terms.peak_ = pool_[It->second].peak_;
+		terms.expiry_ = pool_[It->second].expiry_;
+		return terms;
+	}
+
+	template<template<typename> class T, typename I>
+	void PriceLadderPrototype<T, I>::SetFeed(LevelFeed* feed){
+		std::lock_guard lk(mutex_);
+		feed_ = feed;
+	}
+
+	//Brings the Fenwick trees in line with the level at tick and publishes its new size.
+	template<template<typename> class T, typename I>
+	void PriceLadderPrototype<T, I>::LevelChanged(size_t tick){
+		const PriceLevel& level = LevelAt(tick);
+		size_t page = tick >> kPageBits;
+		size_t& indexed = pages_[page - first_page_]->indexed_[tick & (kPageSize - 1)];
+		size_t depth = level.quantity_ + level.hidden_;
+		if(depth != indexed){
+			if(page < index_base_ || page - index_base_ >= quantities_.Size()){
+				Regrow(page);
+			}
+			uint64_t delta = depth - indexed;
+			quantities_.Add(page - index_base_, delta);
+			notionals_.Add(page - index_base_, delta*tick);
+			indexed = depth;
+		}
+		if(feed_){
+			feed_->Publish(kAscending ? Type::SELL : Type::BUY, tick, level.quantity_);
+		}
+	}
+
+	//Rebuilds the trees over a range of pages at least twice as large that also covers
+	//page, extended downwards when page is below the current range.
+	template<template<typename> class T, typename I>
+	void PriceLadderPrototype<T, I>::Regrow(size_t page){
+		size_t size = quantities_.Size();
+		size_t low = size == 0 ? page : std::min(index_base_, page);
+		size_t high = size == 0 ? page + 1 : std::max(index_base_ + size, page + 1);
+		size_t grown = std::bit_ceil(std::max({2*size, high - low, kPageSize}));
+		if(size != 0 && page < index_base_){
+			index_base_ = high > grown ? high - grown : 0;
+		}else{
+			index_base_ = low;
+		}
+		std::vector<uint64_t> quantities(grown);
+		std::vector<uint64_t> notionals(grown);
+		for(size_t i = 0; i < pages_.size(); ++i){
+			if(!pages_[i]){
+				continue;
+			}
+			size_t first = (first_page_ + i) << kPageBits;
+			for(size_t j = 0; j < kPageSize; ++j){
+				quantities[first_page_ + i - index_base_] += pages_[i]->indexed_[j];
+				notionals[first_page_ + i - index_base_] += pages_[i]->indexed_[j]*(first + j);
+			}
+		}
+		quantities_.Assign(std::move(quantities));
+		notionals_.Assign(std::move(notionals));
+	}
+
+	template<template<typename> class T, typename I>
+	const typename PriceLadderPrototype<T, I>::Page* PriceLadderPrototype<T, I>::PageAt(size_t page) const{
+		if(page < first_page_ || page - first_page_ >= pages_.size()){
+			return nullptr;
+		}
+		return pages_[page - first_page_].get();
+	}
+
+	//Displayed and hidden quantity at prices not worse than tick: the pages before
+	//tick's page from the tree, the levels of its own page one by one.
+	template<template<typename> class T, typename I>
+	size_t PriceLadderPrototype<T, I>::QuantityUpTo(size_t tick) const{
+		std::lock_guard lk(mutex_);
+		size_t page = tick >> kPageBits;
+		size_t size = quantities_.Size();
+		size_t quantity;
+		if(kAscending){
+			quantity = page < index_base_ ? 0 : quantities_.Prefix(std::min(page - index_base_, size));
+		}else if(page < index_base_){
+			quantity = quantities_.Total();
+		}else{
+			quantity = page - index_base_ >= size ? 0 : quantities_.Total() - quantities_.Prefix(page - index_base_ + 1);
+		}
+		if(const Page* p = PageAt(page)){
+			for(size_t i = 0; i < kPageSize; ++i){
+				size_t level = (page << kPageBits) + i;
+				quantity += T<size_t>{}(tick, level) ? 0 : p->indexed_[i];
+			}
+		}
+		return quantity;
+	}
+
+	//The worst level lies on the page where the cumulative quantity from the best
+	//price reaches quantity, found by descending the quantity tree; the pages before
+	//it are taken in full and its levels are walked in price order.
+	template<template<typename> class T, typename I>
+	FillCost PriceLadderPrototype<T, I>::CostOf(size_t quantity) const{
+		FillCost cost;
+		std::lock_guard lk(mutex_);
+		uint64_t total = quantities_.Total();
+		quantity = std::min<uint64_t>(quantity, total);
+		if(quantity == 0){
+			return cost;
+		}
+		size_t index;
+		uint64_t better;
+		uint64_t notional;
+		if(kAscending){
+			index = quantities_.UpperBound(quantity - 1);
+			better = quantities_.Prefix(index);
+			notional = notionals_.Prefix(index);
+		}else{
+			index = quantities_.UpperBound(total - quantity);
+			better = total - quantities_.Prefix(index + 1);
+			notional = notionals_.Total() - notionals_.Prefix(index + 1);
+		}
+		size_t page = index_base_ + index;
+		const Page* p = PageAt(page);
+		size_t tick = page << kPageBits;
+		for(size_t i = 0; i < kPageSize; ++i){
+			tick = (page << kPageBits) + (kAscending ? i : kPageSize - 1 - i);
+			size_t depth = p->indexed_[tick & (kPageSize - 1)];
+			if(better + depth >= quantity){
+				break;
+			}
+			better += depth;
+			notional += depth*tick;
+		}
+		cost.quantity_ = Count(quantity);
+		cost.worst_ = FromTicks(tick);
+		cost.notional_ = notional + (quantity - better)*tick;
+		cost.vwap_ = static_cast<double>(cost.notional_)/static_cast<double>(quantity)/100;
+		return cost;
+	}
+
+	template<template<typename> class T, typename I>
+	std::list<Order> PriceLadderPrototype<T, I>::ShowTop10() const{
+		std::list<Order> top10;
+		size_t counter = 0;
+		std::lock_guard lk(mutex_);
+		for(size_t tick = best_tick_; tick != kNoTick && counter < 10; tick = NextOccupied(Worse(tick))){
+			const PriceLevel& level = LevelAt(tick);
+			for(uint32_t slot = level.head_; slot != OrderPool::kNull && counter < 10; slot = pool_[slot].next_, ++counter){
+				top10.push_back(pool_[slot].order_);
+			}
+		}
+		return top10;
+	}
+
+	template<template<typename> class T, typename I>
+	size_t PriceLadderPrototype<T, I>::ShowTopN(size_t n, std::span<Order> top) const{
+		size_t count = 0;
+		n = std::min(n, top.size());
+		std::lock_guard lk(mutex_);
+		for(size_t tick = best_tick_; tick != kNoTick && count < n; tick = NextOccupied(Worse(tick))){
+			const PriceLevel& level = LevelAt(tick);
+			for(uint32_t slot = level.head_; slot != OrderPool::kNull && count < n; slot = pool_[slot].next_){
+				top[count++] = pool_[slot].order_;
+			}
+		}
+		return count;
+	}
+
+	template<template<typename> class T, typename I>
+	std::list<LevelInfo> PriceLadderPrototype<T, I>::TopLevels(size_t n) const{
+		std::list<LevelInfo> top;
+		for(size_t tick = best_tick_; tick != kNoTick && top.size() < n; tick = NextOccupied(Worse(tick))){
+			const PriceLevel& level = LevelAt(tick);
+			top.push_back({FromTicks(tick), Count(level.quantity_), level.size_});
+		}
+		return top;
+	}
+
+	//Displayed and hidden size at tick, 0 for a tick no page covers.
+	template<template<typename> class T, typename I>
+	size_t PriceLadderPrototype<T, I>::DepthAt(size_t tick) const{
+		size_t page = tick >> kPageBits;
+		if(page < first_page_ || page - first_page_ >= pages_.size() || !pages_[page - first_page_]){
+			return 0;
+		}
+		const PriceLevel& level = LevelAt(tick);
+		return level.quantity_ + level.hidden_;
+	}
+
+	template<template<typename> class T, typename I>
+	PriceLevel& PriceLadderPrototype<T, I>::Level(size_t tick){
+		size_t page = tick >> kPageBits;
+		if(pages_.empty()){
+			first_page_ = page;
+			pages_.resize(1);
+		}else if(page < first_page_){
+			std::vector<std::unique_ptr<Page>> grown(first_page_ - page + pages_.size());
+			std::move(pages_.begin(), pages_.end(), grown.begin() + (first_page_ - page));
+			pages_.swap(grown);
+			first_page_ = page;
+		}else if(page - first_page_ >= pages_.size()){
+			pages_.resize(page - first_page_ + 1);
+		}
+		std::unique_ptr<Page>& p = pages_[page - first_page_];
+		if(!p){
+			p = std::make_unique<Page>();
+		}
+		return p->levels_[tick & (kPageSize - 1)];
+	}
+
+	template<template<typename> class T, typename I>
+	const PriceLevel& PriceLadderPrototype<T, I>::LevelAt(size_t tick) const{
+		return pages_[(tick >> kPageBits) - first_page_]->levels_[tick & (kPageSize - 1)];
+	}
+
+	template<template<typename> class T, typename I>
+	size_t PriceLadderPrototype<T, I>::Worse(size_t tick) const{
+		if(tick == kNoTick || (!kAscending && tick == 0)){
+			return kNoTick;
+		}
+		return kAscending ? tick + 1 : tick - 1;
+	}
+
+	//First non-empty level at tick or worse.
+	template<template<typename> class T, typename I>
+	size_t PriceLadderPrototype<T, I>::NextOccupied(size_t tick) const{
+		if(tick == kNoTick){
+			return kNoTick;
+		}
+		return kAscending ? occupied_.NextUp(tick) : occupied_.NextDown(tick);
+	}
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+
+#include "Order.h"
+#include "ConcurrentOrderBook_HashSet.h"
+#include "oneapi/tbb/concurrent_map.h"
+#include "oneapi/tbb/concurrent_hash_map.h"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <span>
+#include <utility>
+
+namespace OrderBook{
+
+namespace tbb = oneapi::tbb;
+
+	//One side of the book split into contiguous price bands of band_ticks ticks. Every
+	//band is a ConcurrentOrderedBookPrototype with its own lock, so writers at different
+	//prices do not serialize. Bands are created on first use and never erased, which
+	//lets the band map be a tbb::concurrent_map without unsafe_erase.
+	template<typename Comparator, typename BandComparator>
+	class ShardedOrderedBookPrototype{
+	public:
+		using Shard = ConcurrentOrderedBookPrototype<Comparator, false>;
+		using Shards = tbb::concurrent_map<size_t, std::unique_ptr<Shard>, BandComparator>;
+		using Handle = std::pair<Shard*, typename Shard::OrderBook::iterator>;
+
+		explicit ShardedOrderedBookPrototype(size_t band_ticks);
+
+		std::pair<Handle, bool> Add(Order order);
+		void Remove(Handle handle);
+		std::list<Order> ShowTop10() const;
+		size_t ShowTopN(size_t n, std::span<Order> top) const;
+
+	private:
+		Shard* FindShard(size_t band);
+
+	private:
+		size_t band_ticks_;
+		Shards shards_;
+	};
+
+	class ConcurrentOrderBook_Sharded{
+	public:
+		using Bids = ShardedOrderedBookPrototype<std::greater<Order>, std::greater<size_t>>;
+		using Asks = ShardedOrderedBookPrototype<std::less<Order>, std::less<size_t>>;
+		using OrderStorage_bids = tbb::concurrent_hash_map<uint64_t, Bids::Handle>;
+		using OrderStorage_asks = tbb::concurrent_hash_map<uint64_t, Asks::Handle>;
+
+		static constexpr size_t kDefaultBandTicks = 100;
+
+		explicit ConcurrentOrderBook_Sharded(size_t band_ticks = kDefaultBandTicks);
+
+		bool Add(Order order);
+		bool Remove(uint64_t id);
+		bool Change(Order order);
+
+		struct BothTop10{
+			std::list<Order> top10_bids_;
+			std::list<Order> top10_asks_;
+		};
+
+		BothTop10 ShowTop10() const;
+		TopSizes ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const;
+		template<size_t N>
+		BothTop<N> ShowTop() const { return ShowTopOf<N>(*this); }
+
+	private:
+		OrderStorage_bids orders_bids_;
+		OrderStorage_asks orders_asks_;
+		Asks asks_;
+		Bids bids_;
+	};
+
+
+
+	template<typename T, typename B>
+	ShardedOrderedBookPrototype<T, B>::ShardedOrderedBookPrototype(size_t band_ticks): band_ticks_(band_ticks){}
+
+	template<typename T, typename B>
+	typename ShardedOrderedBookPrototype<T, B>::Shard* ShardedOrderedBookPrototype<T, B>::FindShard(size_t band){
+		auto It = shards_.find(band);
+		if(It == shards_.end()){
+			It = shards_.emplace(band, std::make_unique<Shard>()).first;
+		}
+		return It->second.get();
+	}
+
+	template<typename T, typename B>
+	std::pair<typename ShardedOrderedBookPrototype<T, B>::Handle, bool>
+		ShardedOrderedBookPrototype<T, B>::Add(Order order){
+		Shard* shard = FindShard(ToTicks(order.price_)/band_ticks_);
+		auto result = shard->Add(std::move(order));
+		return {{shard, result.first}, result.second};
+	}
+
+	template<typename T, typename B>
+	void ShardedOrderedBookPrototype<T, B>::Remove(Handle handle){
+		handle.first->Remove(handle.second);
+	}
+
+	//Bands are visited from the best price outward until ten orders are collected.
+	template<typename T, typename B>
+	std::list<Order> ShardedOrderedBookPrototype<T, B>::ShowTop10() const{
+		std::list<Order> top10;
+		for(auto It = shards_.begin(); It != shards_.end() && top10.size() < 10; ++It){
+			if(!It->second->Empty()){
+				It->second->ShowTop(top10, 10);
+			}
+		}
+		return top10;
+	}
+
+	//Every band writes its best orders right after those of the bands before it.
+	template<typename T, typename B>
+	size_t ShardedOrderedBookPrototype<T, B>::ShowTopN(size_t n, std::span<Order> top) const{
+		size_t count = 0;
+		n = std::min(n, top.size());
+		for(auto It = shards_.begin(); It != shards_.end() && count < n; ++It){
+			if(!It->second->Empty()){
+				count += It->second->ShowTopN(n - count, top.subspan(count));
+			}
+		}
+		return count;
+	}
+
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+
+#include "Order.h"
+#include "LockFreeSkipList.h"
+#include "oneapi/tbb/concurrent_hash_map.h"
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <span>
+#include <utility>
+
+namespace OrderBook{
+
+namespace tbb = oneapi::tbb;
+
+	template<typename Comparator>
+	class LockFreeOrderedBookPrototype{
+	public:
+
+		using OrderBook = LockFreeSkipList<Order, Comparator>;
+		using Node = typename OrderBook::Node;
+
+		Node* Add(Order order);
+		bool Remove(Node* node);
+		std::list<Order> ShowTop10() const;
+		size_t ShowTopN(size_t n, std::span<Order> top) const;
+
+	private:
+		OrderBook order_book_;
+	};
+
+	class ConcurrentOrderBook_SkipList{
+	public:
+		using OrderStorage_bids = tbb::concurrent_hash_map<uint64_t, typename LockFreeOrderedBookPrototype<std::greater<Order>>::Node*>;
+		using OrderStorage_asks = tbb::concurrent_hash_map<uint64_t, typename LockFreeOrderedBookPrototype<std::less<Order>>::Node*>;
+
+		bool Add(Order order);
+		bool Remove(uint64_t id);
+		bool Change(Order order);
+
+		struct BothTop10{
+			std::list<Order> top10_bids_;
+			std::list<Order> top10_asks_;
+		};
+
+		BothTop10 ShowTop10() const;
+		TopSizes ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const;
+		template<size_t N>
+		BothTop<N> ShowTop() const { return ShowTopOf<N>(*this); }
+
+	private:
+		OrderStorage_bids orders_bids_;
+		OrderStorage_asks orders_asks_;
+		LockFreeOrderedBookPrototype<std::less<Order>> asks_;
+		LockFreeOrderedBookPrototype<std::greater<Order>> bids_;
+	};
+
+
+
+	template<typename T>
+	typename LockFreeOrderedBookPrototype<T>::Node* LockFreeOrderedBookPrototype<T>::Add(Order order){
+		return order_book_.Insert(std::move(order));
+	}
+
+	template<typename T>
+	bool LockFreeOrderedBookPrototype<T>::Remove(Node* node){
+		return order_book_.Erase(node);
+	}
+
+	template<typename T>
+	std::list<Order> LockFreeOrderedBookPrototype<T>::ShowTop10() const{
+		std::list<Order> top10;
+		int counter = 0;
+		typename OrderBook::Guard guard;
+		for(auto node = order_book_.First(); node && counter < 10; node = order_book_.Next(node), ++counter){
+			top10.push_back(node->value_);
+		}
+		return top10;
+	}
+
+	template<typename T>
+	size_t LockFreeOrderedBookPrototype<T>::ShowTopN(size_t n, std::span<Order> top) const{
+		size_t count = 0;
+		n = std::min(n, top.size());
+		typename OrderBook::Guard guard;
+		for(auto node = order_book_.First(); node && count < n; node = order_book_.Next(node)){
+			top[count++] = node->value_;
+		}
+		return count;
+	}
+
+
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace OrderBook{
+
+	//Epoch-based reclamation for lock-free structures. A thread holds a Guard while it
+	//may dereference shared nodes; that pins it to the global epoch. A node that is
+	//no longer reachable is passed to Retire, which tags it with the current epoch and
+	//keeps it in the thread's limbo list. The epoch moves on only once every pinned
+	//thread has seen it, so a node tagged e is freed once the epoch reaches e + 2:
+	//every thread pinned then started after it was unlinked. Guards nest. The limbo
+	//of a thread that exits is handed to the domain and freed by the next collection.
+	//At most kSlots (256) threads can hold a slot at once; a thread takes one on its
+	//first Guard and gives it back when it exits, and the process aborts if a thread
+	//finds them all taken.
+	class EpochDomain{
+	public:
+		using Deleter = void(*)(void*);
+
+		class Guard{
+		public:
+			Guard();
+			~Guard();
+			Guard(const Guard&) = delete;
+			Guard& operator=(const Guard&) = delete;
+		};
+
+		static EpochDomain& Global();
+
+		void Retire(void* node, Deleter deleter);
+
+		~EpochDomain();
+
+	private:
+		static constexpr size_t kSlots = 256;
+		static constexpr size_t kCollectEvery = 128;
+		static constexpr uint64_t kIdle = UINT64_MAX;
+
+		struct Retired{
+			void* node_;
+			Deleter deleter_;
+			uint64_t epoch_;
+		};
+
+		struct alignas(64) Slot{
+			std::atomic<uint64_t> epoch_{kIdle};
+			std::atomic<bool> used_{false};
+		};
+
+		//Per-thread state, created on the first Guard of a thread.
+		struct Local{
+			Local();
+			~Local();
+
+			Slot* slot_;
+			int depth_ = 0;
+			std::vector<Retired> limbo_;
+		};
+
+		static Local& ThisThread();
+		void Pin(Local& local);
+		void Unpin(Local& local);
+		void Collect(Local& local);
+		bool TryAdvance();
+
+	private:
+		Slot slots_[kSlots];
+		std::atomic<uint64_t> epoch_{1};
+		std::mutex orphans_mutex_;
+		std::vector<Retired> orphans_;
+		std::atomic<bool> has_orphans_{false};
+	};
+
+
+	inline EpochDomain& EpochDomain::Global(){
+		static EpochDomain domain;
+		return domain;
+	}
+
+	inline EpochDomain::~EpochDomain(){
+		for(Retired& retired: orphans_){
+			retired.deleter_(retired.node_);
+		}
+	}
+
+	inline EpochDomain::Local::Local(){
+		EpochDomain& domain = Global();
+		for(Slot& slot: domain.slots_){
+			bool expected = false;
+			if(!slot.used_.load(std::memory_order_relaxed) && slot.used_.compare_exchange_strong(expected, true)){
+				slot_ = &slot;
+				return;
+			}
+		}
+		std::fprintf(stderr, "EpochDomain: more than %zu threads hold a slot.\n", kSlots);
+		std::abort();
+	}
+
+	inline EpochDomain::Local::~Local(){
+		EpochDomain& domain = Global();
+		if(!limbo_.empty()){
+			std::lock_guard lk(domain.orphans_mutex_);
+			domain.orphans_.insert(domain.orphans_.end(), limbo_.begin(), limbo_.end());
+			domain.has_orphans_.store(true, std::memory_order_release);
+		}
+		slot_->epoch_.store(kIdle, std::memory_order_release);
+		slot_->used_.store(false, std::memory_order_release);
+	}
+
+	inline EpochDomain::Local& EpochDomain::ThisThread(){
+		thread_local Local local;
+		return local;
+	}
+
+	inline EpochDomain::Guard::Guard(){
+		Global().Pin(ThisThread());
+	}
+
+	inline EpochDomain::Guard::~Guard(){
+		Global().Unpin(ThisThread());
+	}
+
+	//The epoch is read again after the slot is published, so a collector that missed
+	//the slot cannot have moved the epoch past the value stored in it.
+	inline void EpochDomain::Pin(Local& local){
+		if(local.depth_++ != 0){
+			return;
+		}
+		uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+		for(;;){
+			local.slot_->epoch_.store(epoch, std::memory_order_seq_cst);
+			uint64_t current = epoch_.load(std::memory_order_seq_cst);
+			if(current == epoch){
+				return;
+			}
+			epoch = current;
+		}
+	}
+
+	inline void EpochDomain::Unpin(Local& local){
+		if(--local.depth_ == 0){
+			local.slot_->epoch_.store(kIdle, std::memory_order_release);
+		}
+	}
+
+	inline void EpochDomain::Retire(void* node, Deleter deleter){
+		Local& local = ThisThread();
+		local.limbo_.push_back({node, deleter, epoch_.load(std::memory_order_seq_cst)});
+		if(local.limbo_.size() % kCollectEvery == 0){
+			Collect(local);
+		}
+	}
+
+	inline void EpochDomain::Collect(Local& local){
+		if(has_orphans_.load(std::memory_order_acquire)){
+			std::lock_guard lk(orphans_mutex_);
+			local.limbo_.insert(local.limbo_.end(), orphans_.begin(), orphans_.end());
+			orphans_.clear();
+			has_orphans_.store(false, std::memory_order_relaxed);
+		}
+		TryAdvance();
+		uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+		auto It = std::partition(local.limbo_.begin(), local.limbo_.end(), [epoch](const Retired& retired){
+			return retired.epoch_ + 2 > epoch;
+		});
+		for(auto Free = It; Free != local.limbo_.end(); ++Free){
+			Free->deleter_(Free->node_);
+		}
+		local.limbo_.erase(It, local.limbo_.end());
+	}
+
+	inline bool EpochDomain::TryAdvance(){
+		uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+		for(const Slot& slot: slots_){
+			uint64_t pinned = slot.epoch_.load(std::memory_order_seq_cst);
+			if(pinned != kIdle && pinned != epoch){
+				return false;
+			}
+		}
+		return epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+	}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace OrderBook{
+
+	//Binary indexed tree of non-negative counters: point updates, prefix sums and the
+	//search for the longest prefix within a bound, each in O(log size). Deltas are
+	//applied modulo 2^64, so a decrease is passed as the wrapped negative value.
+	class FenwickTree{
+	public:
+		void Assign(std::vector<uint64_t> values);
+		void Add(size_t index, uint64_t delta);
+		uint64_t Prefix(size_t count) const;
+		uint64_t Total() const { return total_; }
+		size_t UpperBound(uint64_t target) const;
+		size_t Size() const { return tree_.size(); }
+
+	private:
+		std::vector<uint64_t> tree_;
+		uint64_t total_ = 0;
+	};
+
+
+	//Builds the tree in place in linear time; node i covers the values (i - lowbit(i), i].
+	inline void FenwickTree::Assign(std::vector<uint64_t> values){
+		tree_ = std::move(values);
+		total_ = 0;
+		for(uint64_t value: tree_){
+			total_ += value;
+		}
+		for(size_t i = 1; i <= tree_.size(); ++i){
+			size_t parent = i + (i & (~i + 1));
+			if(parent <= tree_.size()){
+				tree_[parent - 1] += tree_[i - 1];
+			}
+		}
+	}
+
+	inline void FenwickTree::Add(size_t index, uint64_t delta){
+		total_ += delta;
+		for(size_t i = index + 1; i <= tree_.size(); i += i & (~i + 1)){
+			tree_[i - 1] += delta;
+		}
+	}
+
+	//Sum of the first count values.
+	inline uint64_t FenwickTree::Prefix(size_t count) const{
+		uint64_t sum = 0;
+		for(size_t i = count; i != 0; i &= i - 1){
+			sum += tree_[i - 1];
+		}
+		return sum;
+	}
+
+	//Largest count whose prefix sum does not exceed target.
+	inline size_t FenwickTree::UpperBound(uint64_t target) const{
+		size_t count = 0;
+		for(size_t step = std::bit_floor(tree_.size()); step != 0; step >>= 1){
+			if(count + step <= tree_.size() && tree_[count + step - 1] <= target){
+				count += step;
+				target -= tree_[count - 1];
+			}
+		}
+		return count;
+	}
+
+}
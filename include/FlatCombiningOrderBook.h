@@ -0,0 +1,185 @@
+#pragma once
+
+#include "Order.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace OrderBook{
+
+	//Flat-combining front end for any engine with the Add/Remove/Change/ShowTop10/ShowTopN
+	//interface. A caller posts its request into a free slot and then either waits for it
+	//to be served or takes the combiner lock and serves every pending slot itself, so
+	//the engine is only ever touched by one thread at a time and stays in its cache.
+	template<typename OrderBookImpl>
+	class FlatCombiningOrderBook{
+	public:
+		using BothTop10 = typename OrderBookImpl::BothTop10;
+
+		bool Add(Order order);
+		bool Remove(uint64_t id);
+		bool Change(Order order);
+		BothTop10 ShowTop10() const;
+		TopSizes ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const;
+		template<size_t N>
+		BothTop<N> ShowTop() const { return ShowTopOf<N>(*this); }
+
+	private:
+		static constexpr size_t kSlots = 64;
+
+		enum class Operation{
+			ADD,
+			REMOVE,
+			CHANGE,
+			TOP10,
+			TOPN
+		};
+
+		enum State{
+			FREE = 0,
+			CLAIMED = 1,
+			PENDING = 2,
+			DONE = 3
+		};
+
+		struct TopN{
+			size_t n_;
+			std::span<Order> bids_;
+			std::span<Order> asks_;
+			TopSizes sizes_;
+		};
+
+		struct alignas(64) Slot{
+			std::atomic<int> state_{FREE};
+			Operation operation_;
+			Order order_;
+			uint64_t id_;
+			bool result_;
+			BothTop10* top10_;
+			TopN* topn_;
+		};
+
+		bool Execute(Operation operation, Order order, uint64_t id, BothTop10* top10, TopN* topn = nullptr) const;
+		void Combine() const;
+		void Apply(Slot& slot) const;
+
+	private:
+		mutable OrderBookImpl order_book_;
+		mutable std::array<Slot, kSlots> slots_;
+		mutable std::mutex combiner_;
+	};
+
+
+
+	template<typename T>
+	bool FlatCombiningOrderBook<T>::Add(Order order){
+		return Execute(Operation::ADD, std::move(order), 0, nullptr);
+	}
+
+	template<typename T>
+	bool FlatCombiningOrderBook<T>::Remove(uint64_t id){
+		return Execute(Operation::REMOVE, Order(), id, nullptr);
+	}
+
+	template<typename T>
+	bool FlatCombiningOrderBook<T>::Change(Order order){
+		return Execute(Operation::CHANGE, std::move(order), 0, nullptr);
+	}
+
+	template<typename T>
+	typename FlatCombiningOrderBook<T>::BothTop10 FlatCombiningOrderBook<T>::ShowTop10() const{
+		BothTop10 top10;
+		Execute(Operation::TOP10, Order(), 0, &top10);
+		return top10;
+	}
+
+	template<typename T>
+	TopSizes FlatCombiningOrderBook<T>::ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const{
+		TopN topn{n, bids, asks, {}};
+		Execute(Operation::TOPN, Order(), 0, nullptr, &topn);
+		return topn.sizes_;
+	}
+
+	template<typename T>
+	bool FlatCombiningOrderBook<T>::Execute(Operation operation, Order order, uint64_t id, BothTop10* top10, TopN* topn) const{
+		thread_local size_t preferred = std::hash<std::thread::id>{}(std::this_thread::get_id());
+		size_t index = preferred % kSlots;
+		while(true){
+			int expected = FREE;
+			if(slots_[index].state_.compare_exchange_weak(expected, CLAIMED, std::memory_order_acquire)){
+				break;
+			}
+			index = (index + 1) % kSlots;
+			if(index == preferred % kSlots){
+				std::this_thread::yield();
+			}
+		}
+
+		Slot& slot = slots_[index];
+		slot.operation_ = operation;
+		slot.order_ = std::move(order);
+		slot.id_ = id;
+		slot.top10_ = top10;
+		slot.topn_ = topn;
+		slot.state_.store(PENDING, std::memory_order_release);
+
+		while(slot.state_.load(std::memory_order_acquire) != DONE){
+			if(combiner_.try_lock()){
+				Combine();
+				combiner_.unlock();
+			}else{
+				std::this_thread::yield();
+			}
+		}
+
+		bool result = slot.result_;
+		slot.state_.store(FREE, std::memory_order_release);
+		return result;
+	}
+
+	template<typename T>
+	void FlatCombiningOrderBook<T>::Combine() const{
+		for(Slot& slot: slots_){
+			if(slot.state_.load(std::memory_order_acquire) == PENDING){
+				Apply(slot);
+				slot.state_.store(DONE, std::memory_order_release);
+			}
+		}
+	}
+
+	template<typename T>
+	void FlatCombiningOrderBook<T>::Apply(Slot& slot) const{
+		switch(slot.operation_){
+		case Operation::ADD:
+			slot.result_ = order_book_.Add(std::move(slot.order_));
+			break;
+		case Operation::REMOVE:
+			if constexpr(std::is_void_v<decltype(order_book_.Remove(slot.id_))>){
+				order_book_.Remove(slot.id_);
+				slot.result_ = true;
+			}else{
+				slot.result_ = order_book_.Remove(slot.id_);
+			}
+			break;
+		case Operation::CHANGE:
+			slot.result_ = order_book_.Change(std::move(slot.order_));
+			break;
+		case Operation::TOP10:
+			*slot.top10_ = order_book_.ShowTop10();
+			slot.result_ = true;
+			break;
+		case Operation::TOPN:
+			slot.topn_->sizes_ = order_book_.ShowTopN(slot.topn_->n_, slot.topn_->bids_, slot.topn_->asks_);
+			slot.result_ = true;
+			break;
+		}
+	}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "BroadcastLog.h"
+#include "Order.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace OrderBook{
+
+	//New aggregate displayed quantity of one price level; 0 means the level is gone.
+	struct LevelUpdate{
+		Type side_;
+		Price price_;
+		Count quantity_;
+		uint64_t seq_;
+	};
+
+	//L2 incremental feed of one book over a broadcast log. A book that supports it
+	//creates its feed in EnableLevelUpdates(capacity), called once before the book is
+	//shared, and both sides publish every change of a level from under their own
+	//lock. seq_ is the position of the update in the log, numbered from 1, so every
+	//consumer gets the updates of the whole book in seq_ order through its own Cursor
+	//and DrainLevelUpdates(cursor, batch, max). ShowTopLevels(n) of such a book holds
+	//both side locks, so its levels are exactly the updates up to its seq_ applied;
+	//a consumer that joins late applies the updates after LevelFeed::Cursor(seq_). A
+	//consumer that falls a whole capacity behind sees a gap in seq_ and in Missed()
+	//of its cursor and has to resynchronise from a new ShowTopLevels.
+	class LevelFeed{
+	public:
+		using Cursor = BroadcastLog<LevelUpdate>::Cursor;
+
+		explicit LevelFeed(size_t capacity): log_(capacity){}
+
+		void Publish(Type side, size_t tick, size_t quantity){
+			log_.Publish(LevelUpdate{side, FromTicks(tick), Count(quantity), 0});
+		}
+
+		//Appends up to max updates after the cursor to batch and returns how many.
+		size_t Drain(Cursor& cursor, std::vector<LevelUpdate>& batch, size_t max) const{
+			size_t drained = 0;
+			LevelUpdate update;
+			while(drained < max && log_.TryRead(cursor, update)){
+				update.seq_ = cursor.Seq();
+				batch.push_back(update);
+				++drained;
+			}
+			return drained;
+		}
+
+		uint64_t Claimed() const { return log_.Claimed(); }
+
+	private:
+		BroadcastLog<LevelUpdate> log_;
+	};
+
+}
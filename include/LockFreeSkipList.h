@@ -0,0 +1,246 @@
+#pragma once
+
+#include "EpochDomain.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace OrderBook{
+
+	//Lock-free ordered set of unique keys. Erase marks the node's links (logical
+	//deletion) and the node is unlinked afterwards by whichever traversal meets it
+	//first. Unlinked nodes are reclaimed through EpochDomain: Insert and Erase pin
+	//the calling thread themselves, and a reader holds a Guard across First and Next.
+	//A node has two owners, its inserter and the list. An inserter that finds its node
+	//erased while it was still linking the upper levels unlinks it once more, and
+	//whichever of the two lets go last retires the node, so it is never retired while
+	//a level still points to it.
+	template<typename T, typename Comparator>
+	class LockFreeSkipList{
+	public:
+		static constexpr int kMaxHeight = 24;
+
+		struct Node{
+			T value_;
+			int height_;
+			std::atomic<int> owners_;
+			std::atomic<uintptr_t> next_[1];
+		};
+
+		using Guard = EpochDomain::Guard;
+
+		LockFreeSkipList();
+		~LockFreeSkipList();
+		LockFreeSkipList(const LockFreeSkipList&) = delete;
+		LockFreeSkipList& operator=(const LockFreeSkipList&) = delete;
+
+		Node* Insert(T value);
+		bool Erase(Node* node);
+
+		const Node* First() const;
+		const Node* Next(const Node* node) const;
+
+	private:
+		static Node* Ptr(uintptr_t link){ return reinterpret_cast<Node*>(link & ~uintptr_t{1}); }
+		static bool Marked(uintptr_t link){ return link & 1; }
+		static uintptr_t Link(Node* node){ return reinterpret_cast<uintptr_t>(node); }
+
+		static Node* NewNode(T value, int height);
+		static void DeleteNode(Node* node);
+		static void Reclaim(void* node);
+		static int RandomHeight();
+
+		bool Find(const T& key, Node** preds, Node** succs);
+		Node* Linked(Node* node, Node** preds, Node** succs);
+		void Release(Node* node);
+		const Node* FirstUnmarked(uintptr_t link) const;
+
+	private:
+		Node* head_;
+		Comparator cmp_;
+	};
+
+
+	template<typename T, typename C>
+	LockFreeSkipList<T, C>::LockFreeSkipList(): head_(NewNode(T{}, kMaxHeight)){}
+
+	template<typename T, typename C>
+	LockFreeSkipList<T, C>::~LockFreeSkipList(){
+		Node* node = Ptr(head_->next_[0].load());
+		while(node){
+			Node* next = Ptr(node->next_[0].load());
+			if(!Marked(node->next_[0].load())){
+				DeleteNode(node);
+			}
+			node = next;
+		}
+		DeleteNode(head_);
+	}
+
+	template<typename T, typename C>
+	typename LockFreeSkipList<T, C>::Node* LockFreeSkipList<T, C>::NewNode(T value, int height){
+		void* memory = ::operator new(sizeof(Node) + (height - 1)*sizeof(std::atomic<uintptr_t>));
+		Node* node = static_cast<Node*>(memory);
+		new (&node->value_) T(std::move(value));
+		node->height_ = height;
+		new (&node->owners_) std::atomic<int>(2);
+		for(int level = 0; level < height; ++level){
+			new (&node->next_[level]) std::atomic<uintptr_t>(0);
+		}
+		return node;
+	}
+
+	template<typename T, typename C>
+	void LockFreeSkipList<T, C>::DeleteNode(Node* node){
+		node->value_.~T();
+		::operator delete(node);
+	}
+
+	template<typename T, typename C>
+	void LockFreeSkipList<T, C>::Reclaim(void* node){
+		DeleteNode(static_cast<Node*>(node));
+	}
+
+	template<typename T, typename C>
+	void LockFreeSkipList<T, C>::Release(Node* node){
+		if(node->owners_.fetch_sub(1, std::memory_order_acq_rel) == 1){
+			EpochDomain::Global().Retire(node, &Reclaim);
+		}
+	}
+
+	//Called by the inserter when it is done linking: a node erased meanwhile may
+	//have been linked on a level after its eraser unlinked it.
+	template<typename T, typename C>
+	typename LockFreeSkipList<T, C>::Node* LockFreeSkipList<T, C>::Linked(Node* node, Node** preds, Node** succs){
+		if(Marked(node->next_[0].load(std::memory_order_acquire))){
+			Find(node->value_, preds, succs);
+		}
+		Release(node);
+		return node;
+	}
+
+	template<typename T, typename C>
+	int LockFreeSkipList<T, C>::RandomHeight(){
+		thread_local uint64_t state = 0x9E3779B97F4A7C15ull ^ reinterpret_cast<uintptr_t>(&state);
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		int height = 1;
+		for(uint64_t bits = state; (bits & 1) && height < kMaxHeight; bits >>= 1){
+			++height;
+		}
+		return height;
+	}
+
+	//Fills preds/succs with the neighbours of key on every level and unlinks the
+	//marked nodes met on the way. Returns true if an unmarked node equal to key exists.
+	template<typename T, typename C>
+	bool LockFreeSkipList<T, C>::Find(const T& key, Node** preds, Node** succs){
+	retry:
+		Node* pred = head_;
+		Node* curr = nullptr;
+		for(int level = kMaxHeight - 1; level >= 0; --level){
+			curr = Ptr(pred->next_[level].load(std::memory_order_acquire));
+			while(curr){
+				uintptr_t succ = curr->next_[level].load(std::memory_order_acquire);
+				if(Marked(succ)){
+					uintptr_t expected = Link(curr);
+					if(!pred->next_[level].compare_exchange_strong(expected, Link(Ptr(succ)))){
+						goto retry;
+					}
+					curr = Ptr(succ);
+					continue;
+				}
+				if(!cmp_(curr->value_, key)){
+					break;
+				}
+				pred = curr;
+				curr = Ptr(succ);
+			}
+			preds[level] = pred;
+			succs[level] = curr;
+		}
+		return curr && !cmp_(key, curr->value_);
+	}
+
+	template<typename T, typename C>
+	typename LockFreeSkipList<T, C>::Node* LockFreeSkipList<T, C>::Insert(T value){
+		Guard guard;
+		Node* preds[kMaxHeight];
+		Node* succs[kMaxHeight];
+		if(Find(value, preds, succs)){
+			return nullptr;
+		}
+		Node* node = NewNode(std::move(value), RandomHeight());
+		while(true){
+			for(int level = 0; level < node->height_; ++level){
+				node->next_[level].store(Link(succs[level]), std::memory_order_relaxed);
+			}
+			uintptr_t expected = Link(succs[0]);
+			if(preds[0]->next_[0].compare_exchange_strong(expected, Link(node))){
+				break;
+			}
+			if(Find(node->value_, preds, succs)){
+				DeleteNode(node);
+				return nullptr;
+			}
+		}
+		for(int level = 1; level < node->height_; ++level){
+			while(true){
+				uintptr_t expected = Link(succs[level]);
+				if(preds[level]->next_[level].compare_exchange_strong(expected, Link(node))){
+					break;
+				}
+				Find(node->value_, preds, succs);
+				uintptr_t link = node->next_[level].load();
+				if(Marked(link)){
+					return Linked(node, preds, succs);
+				}
+				if(Ptr(link) != succs[level] && !node->next_[level].compare_exchange_strong(link, Link(succs[level]))){
+					return Linked(node, preds, succs);
+				}
+			}
+		}
+		return Linked(node, preds, succs);
+	}
+
+	//The thread that marks level 0 owns the deletion; it then walks the key once more
+	//so the node is unlinked from every level before it lets go of it.
+	template<typename T, typename C>
+	bool LockFreeSkipList<T, C>::Erase(Node* node){
+		Guard guard;
+		for(int level = node->height_ - 1; level > 0; --level){
+			node->next_[level].fetch_or(1);
+		}
+		if(Marked(node->next_[0].fetch_or(1))){
+			return false;
+		}
+		Node* preds[kMaxHeight];
+		Node* succs[kMaxHeight];
+		Find(node->value_, preds, succs);
+		Release(node);
+		return true;
+	}
+
+	template<typename T, typename C>
+	const typename LockFreeSkipList<T, C>::Node* LockFreeSkipList<T, C>::FirstUnmarked(uintptr_t link) const{
+		Node* node = Ptr(link);
+		while(node && Marked(node->next_[0].load(std::memory_order_acquire))){
+			node = Ptr(node->next_[0].load(std::memory_order_acquire));
+		}
+		return node;
+	}
+
+	template<typename T, typename C>
+	const typename LockFreeSkipList<T, C>::Node* LockFreeSkipList<T, C>::First() const{
+		return FirstUnmarked(head_->next_[0].load(std::memory_order_acquire));
+	}
+
+	template<typename T, typename C>
+	const typename LockFreeSkipList<T, C>::Node* LockFreeSkipList<T, C>::Next(const Node* node) const{
+		return FirstUnmarked(node->next_[0].load(std::memory_order_acquire));
+	}
+
+}
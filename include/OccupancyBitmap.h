@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace OrderBook{
+
+	//Occupancy bitmap over price ticks with kLevels levels of 64-bit words: a bit of
+	//level l+1 is set when the matching word of level l is non-zero. Next-set-bit
+	//queries climb only as far as needed and finish with a count of trailing or leading
+	//zeros per level; the top level is scanned linearly, four words per step so the
+	//compiler can vectorize the test. With kLevels == 1 this is a plain flat bitmap.
+	template<int kLevels>
+	class OccupancyBitmap{
+	public:
+		static constexpr size_t kNone = SIZE_MAX;
+
+		void Set(size_t tick);
+		void Clear(size_t tick);
+		size_t NextUp(size_t tick) const;
+		size_t NextDown(size_t tick) const;
+
+	private:
+		static constexpr size_t kBits = 64;
+
+		void Reserve(size_t tick);
+		void Rebuild();
+		size_t Up(int level, size_t bit) const;
+		size_t Down(int level, size_t bit) const;
+		size_t ScanUp(size_t word) const;
+		size_t ScanDown(size_t word) const;
+
+	private:
+		std::array<std::vector<uint64_t>, kLevels> words_;
+		size_t base_word_ = 0;
+	};
+
+
+	template<int L>
+	void OccupancyBitmap<L>::Set(size_t tick){
+		Reserve(tick);
+		size_t bit = tick - base_word_*kBits;
+		for(int level = 0; level < L; ++level, bit /= kBits){
+			uint64_t& word = words_[level][bit/kBits];
+			bool was_empty = word == 0;
+			word |= uint64_t{1} << (bit % kBits);
+			if(!was_empty){
+				break;
+			}
+		}
+	}
+
+	template<int L>
+	void OccupancyBitmap<L>::Clear(size_t tick){
+		size_t bit = tick - base_word_*kBits;
+		for(int level = 0; level < L; ++level, bit /= kBits){
+			uint64_t& word = words_[level][bit/kBits];
+			word &= ~(uint64_t{1} << (bit % kBits));
+			if(word != 0){
+				break;
+			}
+		}
+	}
+
+	template<int L>
+	size_t OccupancyBitmap<L>::NextUp(size_t tick) const{
+		if(words_[0].empty() || tick == kNone){
+			return kNone;
+		}
+		size_t base = base_word_*kBits;
+		size_t bit = Up(0, tick < base ? 0 : tick - base);
+		return bit == kNone ? kNone : bit + base;
+	}
+
+	template<int L>
+	size_t OccupancyBitmap<L>::NextDown(size_t tick) const{
+		size_t base = base_word_*kBits;
+		if(words_[0].empty() || tick == kNone || tick < base){
+			return kNone;
+		}
+		size_t bit = Down(0, std::min(tick - base, words_[0].size()*kBits - 1));
+		return bit == kNone ? kNone : bit + base;
+	}
+
+	template<int L>
+	size_t OccupancyBitmap<L>::Up(int level, size_t bit) const{
+		const std::vector<uint64_t>& words = words_[level];
+		size_t word = bit/kBits;
+		if(word >= words.size()){
+			return kNone;
+		}
+		uint64_t masked = words[word] & (~uint64_t{0} << (bit % kBits));
+		if(masked != 0){
+			return word*kBits + std::countr_zero(masked);
+		}
+		size_t next = level + 1 == L ? ScanUp(word + 1) : Up(level + 1, word + 1);
+		if(next == kNone){
+			return kNone;
+		}
+		return next*kBits + std::countr_zero(words[next]);
+	}
+
+	template<int L>
+	size_t OccupancyBitmap<L>::Down(int level, size_t bit) const{
+		const std::vector<uint64_t>& words = words_[level];
+		size_t word = bit/kBits;
+		size_t shift = kBits - 1 - bit % kBits;
+		uint64_t masked = words[word] & (~uint64_t{0} >> shift);
+		if(masked != 0){
+			return word*kBits + kBits - 1 - std::countl_zero(masked);
+		}
+		if(word == 0){
+			return kNone;
+		}
+		size_t next = level + 1 == L ? ScanDown(word - 1) : Down(level + 1, word - 1);
+		if(next == kNone){
+			return kNone;
+		}
+		return next*kBits + kBits - 1 - std::countl_zero(words[next]);
+	}
+
+	template<int L>
+	size_t OccupancyBitmap<L>::ScanUp(size_t word) const{
+		const std::vector<uint64_t>& words = words_[L - 1];
+		size_t size = words.size();
+		for(; word + 4 <= size; word += 4){
+			if((words[word] | words[word + 1] | words[word + 2] | words[word + 3]) != 0){
+				break;
+			}
+		}
+		for(; word < size; ++word){
+			if(words[word] != 0){
+				return word;
+			}
+		}
+		return kNone;
+	}
+
+	template<int L>
+	size_t OccupancyBitmap<L>::ScanDown(size_t word) const{
+		const std::vector<uint64_t>& words = words_[L - 1];
+		for(; word >= 3; word -= 4){
+			if((words[word] | words[word - 1] | words[word - 2] | words[word - 3]) != 0){
+				break;
+			}
+			if(word == 3){
+				return kNone;
+			}
+		}
+		for(size_t i = word + 1; i-- > 0;){
+			if(words[i] != 0){
+				return i;
+			}
+		}
+		return kNone;
+	}
+
+	//Grows the covered tick range geometrically in the needed direction; the upper
+	//levels are recomputed because every word index shifts when the base moves.
+	template<int L>
+	void OccupancyBitmap<L>::Reserve(size_t tick){
+		size_t word = tick/kBits;
+		std::vector<uint64_t>& words = words_[0];
+		if(words.empty()){
+			base_word_ = word;
+			words.resize(1);
+		}else if(word < base_word_){
+			size_t grow = std::max(base_word_ - word, std::min(words.size(), base_word_));
+			words.insert(words.begin(), grow, 0);
+			base_word_ -= grow;
+		}else if(word - base_word_ >= words.size()){
+			words.resize(std::max(word - base_word_ + 1, 2*words.size()));
+		}else{
+			return;
+		}
+		Rebuild();
+	}
+
+	template<int L>
+	void OccupancyBitmap<L>::Rebuild(){
+		for(int level = 1; level < L; ++level){
+			const std::vector<uint64_t>& lower = words_[level - 1];
+			std::vector<uint64_t>& upper = words_[level];
+			upper.assign((lower.size() + kBits - 1)/kBits, 0);
+			for(size_t i = 0; i < lower.size(); ++i){
+				if(lower[i] != 0){
+					upper[i/kBits] |= uint64_t{1} << (i % kBits);
+				}
+			}
+		}
+	}
+
+}
@@ -1,6 +1,8 @@
 #pragma once
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <span>
 
 namespace OrderBook{
 
@@ -32,6 +34,12 @@ namespace OrderBook{
 	bool operator==(const Price& left, const Price& right);
 	bool operator<(const Price& left, const Price& right);
 	bool operator>(const Price& left, const Price& right);
+
+	inline size_t ToTicks(const Price& price){
+		return price.integer_part_*100 + price.fractional_part_;
+	}
+
+	Price FromTicks(size_t ticks);
 	
 	
 	struct Count{
@@ -45,6 +53,33 @@ namespace OrderBook{
 	bool operator>(const Count& left, const Count& right);
 
 
+	//Execution conditions, honoured by books in matching mode: IOC executes what it
+	//can and drops the rest, FOK executes in full or not at all. STOP and STOP_LIMIT
+	//orders wait in a trigger book until a trade reaches their stop price and then
+	//enter as an IOC order that sweeps the opposite side or as a limit order at
+	//price_. A MARKET order ignores price_, executes what the opposite side offers
+	//within the book's protection band and drops the rest.
+	enum Flags: uint32_t{
+		NONE = 0,
+		IOC = 1,
+		FOK = 2,
+		STOP = 4,
+		STOP_LIMIT = 8,
+		MARKET = 16
+	};
+
+	//Self-trade prevention, applied by books in matching mode when an incoming order
+	//meets a resting one with the same non-zero owner_: CANCEL_NEWEST drops the rest
+	//of the incoming order, CANCEL_OLDEST cancels the resting one and goes on and
+	//DECREMENT_BOTH takes the smaller size off both without a fill.
+	enum class SelfTrade{
+		NONE,
+		CANCEL_NEWEST,
+		CANCEL_OLDEST,
+		DECREMENT_BOTH
+	};
+
+	//owner_ is the account the order belongs to for self-trade prevention, 0 if none.
 	struct Order{
 		Order();
 		explicit Order(Id id, Price price, Count count, Type type);
@@ -52,11 +87,64 @@ namespace OrderBook{
 		Price price_;
 		Count count_;
 		Type type_;
+		uint32_t flags_ = NONE;
+		uint32_t owner_ = 0;
+	};
+
+	//Terms that only some books honour, passed next to an order instead of inside it
+	//so that every other book stores and copies orders without them. An iceberg is
+	//sent with peak_ set and count_ equal to its whole size. expiry_ is the time after
+	//which a book that supports expiry drops the order; 0 means good till cancelled.
+	//stop_ is the trigger price of a STOP or STOP_LIMIT order.
+	struct OrderTerms{
+		size_t peak_ = 0;
+		uint64_t expiry_ = 0;
+		Price stop_ = Price(0, 0);
 	};
 	
 	bool operator==(const Order& left, const Order& right);
 	bool operator<(const Order& left, const Order& right);
 	bool operator>(const Order& left, const Order& right);
 
+
+	//One execution between a resting order (maker) and an incoming one (taker), at
+	//the maker's price.
+	struct Fill{
+		Id maker_;
+		Id taker_;
+		Price price_;
+		Count count_;
+	};
+
+
+	//Every engine has ShowTopN(n, bids, asks), which copies up to n best orders of
+	//each side into the caller's buffers, and ShowTop<N>(), which does the same into
+	//the arrays of a BothTop<N>; engine comments say where a query may allocate.
+	//TopSizes is the number of orders ShowTopN wrote for each side.
+	struct TopSizes{
+		size_t bids_ = 0;
+		size_t asks_ = 0;
+	};
+
+	//Top of both sides with the depth fixed at compile time, returned by ShowTop<N>
+	//without touching the heap; only the first bids_size_ and asks_size_ entries are set.
+	template<size_t N>
+	struct BothTop{
+		std::array<Order, N> bids_;
+		std::array<Order, N> asks_;
+		size_t bids_size_ = 0;
+		size_t asks_size_ = 0;
+	};
+
+	//ShowTop<N> of every engine, on top of its ShowTopN.
+	template<size_t N, typename OrderBookImpl>
+	BothTop<N> ShowTopOf(const OrderBookImpl& order_book){
+		BothTop<N> top;
+		TopSizes sizes = order_book.ShowTopN(N, top.bids_, top.asks_);
+		top.bids_size_ = sizes.bids_;
+		top.asks_size_ = sizes.asks_;
+		return top;
+	}
+
 }
 
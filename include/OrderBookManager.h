@@ -0,0 +1,158 @@
+#pragma once
+
+#include "Order.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace OrderBook{
+
+	struct BothTop10Orders{
+		std::list<Order> top10_bids_;
+		std::list<Order> top10_asks_;
+	};
+
+	//Engine-independent view of one book, so books of different engines can live in
+	//one manager.
+	class IOrderBook{
+	public:
+		virtual ~IOrderBook() = default;
+
+		virtual bool Add(Order order) = 0;
+		virtual bool Remove(uint64_t id) = 0;
+		virtual bool Change(Order order) = 0;
+		virtual BothTop10Orders ShowTop10() const = 0;
+		virtual TopSizes ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const = 0;
+	};
+
+	template<typename OrderBookImpl>
+	class OrderBookAdapter: public IOrderBook{
+	public:
+		bool Add(Order order) override{
+			return order_book_.Add(std::move(order));
+		}
+
+		bool Remove(uint64_t id) override{
+			if constexpr(std::is_void_v<decltype(order_book_.Remove(id))>){
+				order_book_.Remove(id);
+				return true;
+			}else{
+				return order_book_.Remove(id);
+			}
+		}
+
+		bool Change(Order order) override{
+			return order_book_.Change(std::move(order));
+		}
+
+		BothTop10Orders ShowTop10() const override{
+			auto top10 = order_book_.ShowTop10();
+			return {std::move(top10.top10_bids_), std::move(top10.top10_asks_)};
+		}
+
+		TopSizes ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const override{
+			return order_book_.ShowTopN(n, bids, asks);
+		}
+
+	private:
+		OrderBookImpl order_book_;
+	};
+
+	//Owns one book per symbol. Books are registered before trading starts; AddBook
+	//must not run concurrently with any other call.
+	//Add/Remove/Change/ShowTop10/ShowTopN run on the calling thread. Submit instead hands the
+	//request to the worker that owns the symbol: symbols are assigned to workers
+	//round-robin in registration order, every worker is pinned to one core and is the
+	//only thread touching its books. Flush waits until all submitted requests are
+	//applied. A symbol should be driven either directly or through Submit, not both.
+	class OrderBookManager{
+	public:
+		enum class Operation{
+			ADD,
+			REMOVE,
+			CHANGE
+		};
+
+		struct BookStats{
+			size_t processed_ = 0;
+			size_t latency_ns_ = 0;
+		};
+
+		explicit OrderBookManager(size_t workers = 0);
+		~OrderBookManager();
+		OrderBookManager(const OrderBookManager&) = delete;
+		OrderBookManager& operator=(const OrderBookManager&) = delete;
+
+		template<typename OrderBookImpl>
+		bool AddBook(uint32_t symbol);
+		bool AddBook(uint32_t symbol, std::unique_ptr<IOrderBook> book);
+
+		bool Add(uint32_t symbol, Order order);
+		bool Remove(uint32_t symbol, uint64_t id);
+		bool Change(uint32_t symbol, Order order);
+		BothTop10Orders ShowTop10(uint32_t symbol) const;
+		TopSizes ShowTopN(uint32_t symbol, size_t n, std::span<Order> bids, std::span<Order> asks) const;
+
+		void Submit(uint32_t symbol, Operation operation, Order order);
+		void Flush() const;
+
+		//Summed queueing plus execution time of the requests submitted for symbol;
+		//valid after Flush.
+		BookStats Stats(uint32_t symbol) const;
+		size_t Workers() const { return workers_.size(); }
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Book{
+			std::unique_ptr<IOrderBook> book_;
+			size_t worker_;
+			BookStats stats_;
+		};
+
+		struct Request{
+			Book* book_ = nullptr;
+			Operation operation_ = Operation::ADD;
+			Order order_;
+			Clock::time_point submitted_;
+		};
+
+		//Requests are appended under mutex_ and the worker takes the whole queue at
+		//once, so a busy worker pays for the lock once per batch.
+		struct alignas(64) Worker{
+			std::mutex mutex_;
+			std::condition_variable ready_;
+			std::vector<Request> queue_;
+			bool stop_ = false;
+			std::atomic<size_t> submitted_{0};
+			std::atomic<size_t> done_{0};
+			std::thread thread_;
+		};
+
+		void Run(size_t worker);
+		static void Apply(Book& book, Request& request);
+
+	private:
+		std::unordered_map<uint32_t, Book> books_;
+		std::vector<std::unique_ptr<Worker>> workers_;
+	};
+
+
+
+	template<typename OrderBookImpl>
+	bool OrderBookManager::AddBook(uint32_t symbol){
+		return AddBook(symbol, std::make_unique<OrderBookAdapter<OrderBookImpl>>());
+	}
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "BroadcastLog.h"
+#include "Order.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace OrderBook{
+
+	//One change of one resting order; order_ is its state after the change. A
+	//consumer keeps the orders by id: ADD, MODIFY and EXECUTE store order_, CANCEL
+	//erases its id. MODIFY is an amend by the owner, EXECUTE a reduction by a fill,
+	//published only by a book that matches.
+	struct OrderEvent{
+		enum class Kind: uint8_t{
+			ADD,
+			CANCEL,
+			MODIFY,
+			EXECUTE
+		};
+
+		Kind kind_;
+		Order order_;
+		uint64_t seq_;
+	};
+
+	//L3 order-by-order feed of one book over a broadcast log, so every consumer sees
+	//every event through its own Cursor. seq_ is the position of the event in the
+	//log, numbered from 1. Writers publish after their change to the book and from
+	//under the accessor of the order's id, so the events of one id get increasing
+	//seq_ in the order of its changes. Claimed is the number of events given a seq_
+	//so far; every change they describe is already in the book. A consumer that falls
+	//a whole capacity behind loses the oldest events, which shows as a gap in seq_
+	//and in Missed() of its cursor, and has to resynchronise from a new snapshot.
+	class OrderFeed{
+	public:
+		using Cursor = BroadcastLog<OrderEvent>::Cursor;
+
+		explicit OrderFeed(size_t capacity): log_(capacity){}
+
+		void Publish(OrderEvent::Kind kind, const Order& order){
+			log_.Publish(OrderEvent{kind, order, 0});
+		}
+
+		//Appends up to max events after the cursor to batch and returns how many.
+		size_t Drain(Cursor& cursor, std::vector<OrderEvent>& batch, size_t max) const{
+			size_t drained = 0;
+			OrderEvent event;
+			while(drained < max && log_.TryRead(cursor, event)){
+				event.seq_ = cursor.Seq();
+				batch.push_back(event);
+				++drained;
+			}
+			return drained;
+		}
+
+		uint64_t Claimed() const { return log_.Claimed(); }
+
+	private:
+		BroadcastLog<OrderEvent> log_;
+	};
+
+}
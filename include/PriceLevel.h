@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Order.h"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace OrderBook{
+
+	//While an iceberg rests, order_.count_ is its displayed slice, hidden_ the reserve
+	//behind it and peak_ the size of a slice. expiry_ is 0 for an order without one.
+	struct OrderNode{
+		Order order_;
+		uint32_t prev_;
+		uint32_t next_;
+		size_t peak_ = 0;
+		size_t hidden_ = 0;
+		uint64_t expiry_ = 0;
+	};
+
+	//Orders of a book side live in one vector and are addressed by slot, so a level
+	//is a pair of slots and unlinking an order never touches the allocator.
+	class OrderPool{
+	public:
+		static constexpr uint32_t kNull = UINT32_MAX;
+
+		uint32_t Allocate(Order order);
+		void Free(uint32_t slot);
+
+		OrderNode& operator[](uint32_t slot){ return nodes_[slot]; }
+		const OrderNode& operator[](uint32_t slot) const { return nodes_[slot]; }
+
+	private:
+		std::vector<OrderNode> nodes_;
+		uint32_t free_ = kNull;
+	};
+
+	//Aggregated view of one price level.
+	struct LevelInfo{
+		Price price_;
+		Count quantity_;
+		size_t orders_;
+	};
+
+	//Queue of the orders resting at one price, kept in priority order, together with
+	//the level totals so depth queries do not have to walk the queue. quantity_ is the
+	//displayed size and hidden_ the iceberg reserve.
+	struct PriceLevel{
+		template<typename Before>
+		void Insert(OrderPool& pool, uint32_t slot, Before before);
+		void Unlink(OrderPool& pool, uint32_t slot);
+		bool Empty() const { return head_ == OrderPool::kNull; }
+
+		uint32_t head_ = OrderPool::kNull;
+		uint32_t tail_ = OrderPool::kNull;
+		uint32_t size_ = 0;
+		size_t quantity_ = 0;
+		size_t hidden_ = 0;
+	};
+
+
+	inline uint32_t OrderPool::Allocate(Order order){
+		uint32_t slot;
+		if(free_ != kNull){
+			slot = free_;
+			free_ = nodes_[slot].next_;
+			nodes_[slot] = {std::move(order), kNull, kNull};
+		}else{
+			slot = static_cast<uint32_t>(nodes_.size());
+			nodes_.push_back({std::move(order), kNull, kNull});
+		}
+		return slot;
+	}
+
+	inline void OrderPool::Free(uint32_t slot){
+		nodes_[slot].next_ = free_;
+		free_ = slot;
+	}
+
+	//Probes from the tail, so an order that ranks last at its price is linked in O(1).
+	template<typename Before>
+	void PriceLevel::Insert(OrderPool& pool, uint32_t slot, Before before){
+		uint32_t pos = tail_;
+		while(pos != OrderPool::kNull && before(pool[slot].order_, pool[pos].order_)){
+			pos = pool[pos].prev_;
+		}
+		OrderNode& node = pool[slot];
+		node.prev_ = pos;
+		if(pos == OrderPool::kNull){
+			node.next_ = head_;
+			head_ = slot;
+		}else{
+			node.next_ = pool[pos].next_;
+			pool[pos].next_ = slot;
+		}
+		if(node.next_ == OrderPool::kNull){
+			tail_ = slot;
+		}else{
+			pool[node.next_].prev_ = slot;
+		}
+		++size_;
+		quantity_ += node.order_.count_.val_;
+		hidden_ += node.hidden_;
+	}
+
+	inline void PriceLevel::Unlink(OrderPool& pool, uint32_t slot){
+		OrderNode& node = pool[slot];
+		if(node.prev_ == OrderPool::kNull){
+			head_ = node.next_;
+		}else{
+			pool[node.prev_].next_ = node.next_;
+		}
+		if(node.next_ == OrderPool::kNull){
+			tail_ = node.prev_;
+		}else{
+			pool[node.next_].prev_ = node.prev_;
+		}
+		--size_;
+		quantity_ -= node.order_.count_.val_;
+		hidden_ -= node.hidden_;
+	}
+
+}
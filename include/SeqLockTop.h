@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Order.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace OrderBook{
+
+	//Fixed-size top of one book side published under a sequence lock. Publish must be
+	//serialized by the caller; Read never blocks a writer and retries only while a
+	//publication is in progress. Orders are stored as atomic words so a torn copy is
+	//detected by the sequence check instead of being a data race: payload stores are
+	//release and payload loads acquire, which orders them against the sequence loads
+	//without standalone fences.
+	template<size_t N>
+	class SeqLockTop{
+	public:
+		template<typename Iterator>
+		void Publish(Iterator first, Iterator last);
+		size_t Read(std::array<Order, N>& out) const;
+
+	private:
+		static constexpr size_t kWords = 5;
+
+		std::atomic<uint64_t> seq_{0};
+		std::atomic<uint64_t> size_{0};
+		std::array<std::atomic<uint64_t>, N*kWords> words_{};
+	};
+
+
+	template<size_t N>
+	template<typename Iterator>
+	void SeqLockTop<N>::Publish(Iterator first, Iterator last){
+		uint64_t seq = seq_.load(std::memory_order_relaxed);
+		seq_.store(seq + 1, std::memory_order_relaxed);
+		size_t size = 0;
+		for(; first != last && size < N; ++first, ++size){
+			const Order& order = *first;
+			std::atomic<uint64_t>* w = &words_[size*kWords];
+			w[0].store(order.id_.val_, std::memory_order_release);
+			w[1].store(order.price_.integer_part_, std::memory_order_release);
+			w[2].store(order.price_.fractional_part_, std::memory_order_release);
+			w[3].store(order.count_.val_, std::memory_order_release);
+			w[4].store(static_cast<uint64_t>(order.type_), std::memory_order_release);
+		}
+		size_.store(size, std::memory_order_release);
+		seq_.store(seq + 2, std::memory_order_release);
+	}
+
+	template<size_t N>
+	size_t SeqLockTop<N>::Read(std::array<Order, N>& out) const{
+		size_t size;
+		uint64_t before;
+		uint64_t after;
+		do{
+			before = seq_.load(std::memory_order_acquire);
+			size = size_.load(std::memory_order_acquire);
+			for(size_t i = 0; i < size && i < N; ++i){
+				const std::atomic<uint64_t>* w = &words_[i*kWords];
+				out[i].id_.val_ = w[0].load(std::memory_order_acquire);
+				out[i].price_.integer_part_ = w[1].load(std::memory_order_acquire);
+				out[i].price_.fractional_part_ = w[2].load(std::memory_order_acquire);
+				out[i].count_.val_ = w[3].load(std::memory_order_acquire);
+				out[i].type_ = static_cast<Type>(w[4].load(std::memory_order_acquire));
+			}
+			after = seq_.load(std::memory_order_relaxed);
+		}while((before & 1) || before != after);
+		return size;
+	}
+
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "Order.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace OrderBook{
+
+	//Top of a book at one moment, never changed after it is published. version_ counts
+	//the publications of its book from 1; updates_ is the number of writes the book had
+	//accepted when the snapshot was taken.
+	struct BookSnapshot{
+		uint64_t version_ = 0;
+		uint64_t updates_ = 0;
+		std::vector<Order> bids_;
+		std::vector<Order> asks_;
+	};
+
+	//Front end for any engine with ShowTopN that publishes the top depth orders of each
+	//side as a BookSnapshot every `every` accepted writes, taken by the writer that
+	//completes them, and every interval, taken by a background thread if anything was
+	//written since the last one; zero turns either trigger off. Only publishers take
+	//publish_mutex_. The newest snapshot is swapped in under latest_mutex_, held just for
+	//a pointer copy, and its version is then stored in an atomic; readers never touch
+	//the engine locks and keep a snapshot alive for as long as they hold it.
+	//A Consumer conflates: Poll checks the atomic version first, so a poll with nothing
+	//new is one load, and otherwise returns the newest snapshot and counts the versions
+	//it never saw. A slow consumer only skips versions; it never holds back the book or
+	//other consumers. Latest is nullptr until the first publication.
+	template<typename OrderBookImpl>
+	class SnapshotPublisher{
+	public:
+		using BothTop10 = typename OrderBookImpl::BothTop10;
+
+		class Consumer{
+		public:
+			explicit Consumer(const SnapshotPublisher& publisher): publisher_(&publisher){}
+
+			std::shared_ptr<const BookSnapshot> Poll();
+			uint64_t Skipped() const { return skipped_; }
+
+		private:
+			const SnapshotPublisher* publisher_;
+			uint64_t version_ = 0;
+			uint64_t skipped_ = 0;
+		};
+
+		explicit SnapshotPublisher(size_t depth = 10, size_t every = 0,
+									std::chrono::microseconds interval = std::chrono::microseconds(0));
+
+		bool Add(Order order);
+		bool Remove(uint64_t id);
+		bool Change(Order order);
+		BothTop10 ShowTop10() const;
+		TopSizes ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const;
+		template<size_t N>
+		BothTop<N> ShowTop() const { return ShowTopOf<N>(*this); }
+
+		void Publish();
+		std::shared_ptr<const BookSnapshot> Latest() const;
+		uint64_t Version() const { return published_version_.load(std::memory_order_acquire); }
+
+	private:
+		bool Updated(bool accepted);
+		void Take();
+		void Run(std::stop_token stop);
+
+	private:
+		OrderBookImpl order_book_;
+		size_t depth_;
+		size_t every_;
+		std::chrono::microseconds interval_;
+		std::atomic<uint64_t> updates_{0};
+		std::shared_ptr<const BookSnapshot> latest_;
+		mutable std::mutex latest_mutex_;
+		std::atomic<uint64_t> published_version_{0};
+		std::mutex publish_mutex_;
+		uint64_t version_ = 0;
+		uint64_t published_updates_ = 0;
+		std::mutex timer_mutex_;
+		std::condition_variable_any timer_;
+		std::jthread timer_thread_;
+	};
+
+
+
+	template<typename T>
+	SnapshotPublisher<T>::SnapshotPublisher(size_t depth, size_t every, std::chrono::microseconds interval):
+		depth_(depth), every_(every), interval_(interval){
+		if(interval_.count() != 0){
+			timer_thread_ = std::jthread([this](std::stop_token stop){ Run(stop); });
+		}
+	}
+
+	template<typename T>
+	bool SnapshotPublisher<T>::Add(Order order){
+		return Updated(order_book_.Add(std::move(order)));
+	}
+
+	template<typename T>
+	bool SnapshotPublisher<T>::Remove(uint64_t id){
+		if constexpr(std::is_void_v<decltype(order_book_.Remove(id))>){
+			order_book_.Remove(id);
+			return Updated(true);
+		}else{
+			return Updated(order_book_.Remove(id));
+		}
+	}
+
+	template<typename T>
+	bool SnapshotPublisher<T>::Change(Order order){
+		return Updated(order_book_.Change(std::move(order)));
+	}
+
+	template<typename T>
+	typename SnapshotPublisher<T>::BothTop10 SnapshotPublisher<T>::ShowTop10() const{
+		return order_book_.ShowTop10();
+	}
+
+	template<typename T>
+	TopSizes SnapshotPublisher<T>::ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const{
+		return order_book_.ShowTopN(n, bids, asks);
+	}
+
+	template<typename T>
+	void SnapshotPublisher<T>::Publish(){
+		std::lock_guard lk(publish_mutex_);
+		Take();
+	}
+
+	template<typename T>
+	std::shared_ptr<const BookSnapshot> SnapshotPublisher<T>::Latest() const{
+		std::lock_guard lk(latest_mutex_);
+		return latest_;
+	}
+
+	template<typename T>
+	bool SnapshotPublisher<T>::Updated(bool accepted){
+		if(accepted){
+			uint64_t updates = updates_.fetch_add(1, std::memory_order_acq_rel) + 1;
+			if(every_ != 0 && updates % every_ == 0){
+				Publish();
+			}
+		}
+		return accepted;
+	}
+
+	//Called under publish_mutex_.
+	template<typename T>
+	void SnapshotPublisher<T>::Take(){
+		auto snapshot = std::make_shared<BookSnapshot>();
+		snapshot->updates_ = updates_.load(std::memory_order_acquire);
+		snapshot->bids_.resize(depth_);
+		snapshot->asks_.resize(depth_);
+		TopSizes sizes = order_book_.ShowTopN(depth_, snapshot->bids_, snapshot->asks_);
+		snapshot->bids_.resize(sizes.bids_);
+		snapshot->asks_.resize(sizes.asks_);
+		snapshot->version_ = ++version_;
+		published_updates_ = snapshot->updates_;
+		std::shared_ptr<const BookSnapshot> previous;
+		{
+			std::lock_guard lk(latest_mutex_);
+			previous = std::exchange(latest_, std::move(snapshot));
+		}
+		published_version_.store(version_, std::memory_order_release);
+	}
+
+	template<typename T>
+	void SnapshotPublisher<T>::Run(std::stop_token stop){
+		std::unique_lock lk(timer_mutex_);
+		while(!timer_.wait_for(lk, stop, interval_, [&stop](){ return stop.stop_requested(); })){
+			std::lock_guard publish_lk(publish_mutex_);
+			if(updates_.load(std::memory_order_acquire) != published_updates_){
+				Take();
+			}
+		}
+	}
+
+	template<typename T>
+	std::shared_ptr<const BookSnapshot> SnapshotPublisher<T>::Consumer::Poll(){
+		if(publisher_->Version() <= version_){
+			return nullptr;
+		}
+		std::shared_ptr<const BookSnapshot> snapshot = publisher_->Latest();
+		if(!snapshot || snapshot->version_ <= version_){
+			return nullptr;
+		}
+		skipped_ += snapshot->version_ - version_ - 1;
+		version_ = snapshot->version_;
+		return snapshot;
+	}
+
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "Order.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace OrderBook{
+
+	//Stop and stop-limit orders in front of an engine in matching mode (one with
+	//Add(order, terms, sink) and AddBatch(orders, sink)). Parked stops live in one
+	//index per side ordered by the stop_ of their terms, so a trade that moved the price from one end of a
+	//range to the other visits only the stops inside that range. Everything a round
+	//of trades triggered is converted and handed to the engine as one batch, whose
+	//trades may trigger the next round. A stop fires only on trades after it arrived.
+	template<typename OrderBookImpl>
+	class StopOrderBook{
+	public:
+		using BothTop10 = typename OrderBookImpl::BothTop10;
+
+		explicit StopOrderBook(bool time_priority = false, SelfTrade self_trade = SelfTrade::NONE);
+
+		bool Add(Order order, OrderTerms terms = {});
+		template<typename FillSink>
+		bool Add(Order order, FillSink&& sink);
+		template<typename FillSink>
+		bool Add(Order order, OrderTerms terms, FillSink&& sink);
+		bool Remove(uint64_t id);
+		bool Change(Order order, OrderTerms terms = {});
+		BothTop10 ShowTop10() const;
+		TopSizes ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const;
+		template<size_t N>
+		BothTop<N> ShowTop() const { return ShowTopOf<N>(*this); }
+		size_t Parked() const;
+
+	private:
+		//Comparator<size_t> orders triggers so that the stops that fire first come first.
+		template<template<typename> class Comparator>
+		class TriggerSide{
+		public:
+			bool Park(Order order, const OrderTerms& terms);
+			bool Remove(uint64_t id);
+			void Fire(size_t ticks, std::vector<std::pair<Order, OrderTerms>>& batch);
+			size_t Size() const { return stops_.size(); }
+
+		private:
+			using Index = std::multimap<size_t, std::pair<Order, OrderTerms>, Comparator<size_t>>;
+
+			Index stops_;
+			std::unordered_map<uint64_t, typename Index::iterator> ids_;
+		};
+
+		static Order Convert(Order stop);
+
+	private:
+		OrderBookImpl order_book_;
+		TriggerSide<std::less> buy_stops_;
+		TriggerSide<std::greater> sell_stops_;
+		mutable std::mutex stops_mutex_;
+	};
+
+
+
+	template<typename T>
+	StopOrderBook<T>::StopOrderBook(bool time_priority, SelfTrade self_trade): order_book_(true, time_priority, self_trade){}
+
+	template<typename T>
+	bool StopOrderBook<T>::Add(Order order, OrderTerms terms){
+		return Add(std::move(order), terms, [](const Fill&){});
+	}
+
+	template<typename T>
+	template<typename FillSink>
+	bool StopOrderBook<T>::Add(Order order, FillSink&& sink){
+		return Add(std::move(order), OrderTerms{}, sink);
+	}
+
+	template<typename T>
+	template<typename FillSink>
+	bool StopOrderBook<T>::Add(Order order, OrderTerms terms, FillSink&& sink){
+		if(order.flags_ & (STOP | STOP_LIMIT)){
+			std::lock_guard lk(stops_mutex_);
+			if(order.type_ == Type::BUY){
+				return buy_stops_.Park(std::move(order), terms);
+			}
+			return sell_stops_.Park(std::move(order), terms);
+		}
+
+		size_t high = 0;
+		size_t low = std::numeric_limits<size_t>::max();
+		bool traded = false;
+		auto track = [&high, &low, &traded, &sink](const Fill& fill){
+			size_t ticks = ToTicks(fill.price_);
+			high = std::max(high, ticks);
+			low = std::min(low, ticks);
+			traded = true;
+			sink(fill);
+		};
+
+		bool result = order_book_.Add(std::move(order), terms, track);
+		std::vector<std::pair<Order, OrderTerms>> batch;
+		while(traded){
+			traded = false;
+			{
+				std::lock_guard lk(stops_mutex_);
+				buy_stops_.Fire(high, batch);
+				sell_stops_.Fire(low, batch);
+			}
+			if(batch.empty()){
+				break;
+			}
+			for(auto& [stop, stop_terms]: batch){
+				stop = Convert(std::move(stop));
+			}
+			order_book_.AddBatch(batch, track);
+			batch.clear();
+		}
+		return result;
+	}
+
+	template<typename T>
+	bool StopOrderBook<T>::Remove(uint64_t id){
+		{
+			std::lock_guard lk(stops_mutex_);
+			if(buy_stops_.Remove(id) || sell_stops_.Remove(id)){
+				return true;
+			}
+		}
+		return order_book_.Remove(id);
+	}
+
+	template<typename T>
+	bool StopOrderBook<T>::Change(Order order, OrderTerms terms){
+		Remove(order.id_.val_);
+		return Add(std::move(order), terms);
+	}
+
+	template<typename T>
+	typename StopOrderBook<T>::BothTop10 StopOrderBook<T>::ShowTop10() const{
+		return order_book_.ShowTop10();
+	}
+
+	template<typename T>
+	TopSizes StopOrderBook<T>::ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const{
+		return order_book_.ShowTopN(n, bids, asks);
+	}
+
+	template<typename T>
+	size_t StopOrderBook<T>::Parked() const{
+		std::lock_guard lk(stops_mutex_);
+		return buy_stops_.Size() + sell_stops_.Size();
+	}
+
+	//A stop becomes an IOC order priced through the whole opposite side, a stop-limit
+	//a plain order at its limit.
+	template<typename T>
+	Order StopOrderBook<T>::Convert(Order stop){
+		if(stop.flags_ & STOP){
+			stop.flags_ |= IOC;
+			stop.price_ = stop.type_ == Type::BUY ? Price(std::numeric_limits<uint32_t>::max(), 99) : Price(0, 0);
+		}
+		stop.flags_ &= ~static_cast<uint32_t>(STOP | STOP_LIMIT);
+		return stop;
+	}
+
+	template<typename T>
+	template<template<typename> class C>
+	bool StopOrderBook<T>::TriggerSide<C>::Park(Order order, const OrderTerms& terms){
+		uint64_t id = order.id_.val_;
+		if(ids_.contains(id)){
+			return false;
+		}
+		size_t ticks = ToTicks(terms.stop_);
+		ids_.emplace(id, stops_.emplace(ticks, std::pair(std::move(order), terms)));
+		return true;
+	}
+
+	template<typename T>
+	template<template<typename> class C>
+	bool StopOrderBook<T>::TriggerSide<C>::Remove(uint64_t id){
+		auto It = ids_.find(id);
+		if(It == ids_.end()){
+			return false;
+		}
+		stops_.erase(It->second);
+		ids_.erase(It);
+		return true;
+	}
+
+	//Moves every stop whose trigger the price ticks has reached into batch, in
+	//trigger order.
+	template<typename T>
+	template<template<typename> class C>
+	void StopOrderBook<T>::TriggerSide<C>::Fire(size_t ticks, std::vector<std::pair<Order, OrderTerms>>& batch){
+		auto It = stops_.begin();
+		for(; It != stops_.end() && !C<size_t>{}(ticks, It->first); ++It){
+			ids_.erase(It->second.first.id_.val_);
+			batch.push_back(std::move(It->second));
+		}
+		stops_.erase(stops_.begin(), It);
+	}
+
+}
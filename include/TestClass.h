@@ -1,6 +1,12 @@
 #pragma once
 
+#include "LevelFeed.h"
 #include "Order.h"
+#include "OrderFeed.h"
+#include "OrderBookManager.h"
+#include "SnapshotPublisher.h"
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <utility>
 #include <memory>
@@ -11,6 +17,13 @@
 #include <barrier>
 #include <thread>
 #include <cstddef>
+#include <fstream>
+#include <map>
+#include <functional>
+#include <unordered_map>
+#include <malloc.h>
+#include <unistd.h>
+#include <cmath>
 
 namespace OrderBook{
 
@@ -27,30 +40,77 @@ namespace OrderBook{
 		void TestEraseAndTop10();
 		void TestChangeAndTop10();
 		void TestInsertEraseChangeTop10();
+		void TestShowTopN();
+		void TestModifyAndTop10();
+		void TestAddAndTopLevels();
+		void TestMatching();
+		void TestImmediateOrders();
+		void TestIceberg();
+		void TestStopOrders();
+		void TestExpiry();
+		void TestSelfTrade();
+		void TestAuction();
+		void TestMarketOrders();
+		void TestDepthQueries();
+		void ConcurrentTestLevelUpdates();
 
 		void ConcurrentTestAddAndTop10();
 		void ConcurrentTestEraseAndTop10();
 		void ConcurrentTestChangeAndTop10();
+		void ConcurrentTestAddAndSnapshotTop10();
+		void ConcurrentTestTimePriority();
+		void ConcurrentTestSnapshotPublisher();
+		void ConcurrentTestOrderEvents();
 
-		std::vector<std::vector<size_t>> MeasureOneThread();
+		std::vector<std::vector<size_t>> MeasureOneThread(const std::vector<size_t>& elements_count = {1000, 5000, 10000, 50000});
 
 		size_t MeasureOneThreadAdd(size_t count, size_t half_range);
 		size_t MeasureOneThreadRemove(size_t count, size_t half_range);
 		size_t MeasureOneThreadChange(size_t count, size_t half_range);
 		size_t MeasureOneThreadTop10(size_t count, size_t half_range);
+		size_t MeasureOneThreadCancelBestTop10(size_t count, size_t half_range);
+		std::vector<std::vector<size_t>> MeasureTopN(size_t count);
+		size_t MeasureOneThreadTopN(const OrderBookImpl& obj, size_t n, size_t queries);
+		template<size_t N>
+		size_t MeasureOneThreadShowTop(const OrderBookImpl& obj, size_t queries);
+		std::vector<std::vector<size_t>> MeasureAmends(const std::vector<size_t>& elements_count);
+		size_t MeasureOneThreadAmend(size_t count, bool modify);
+
+		std::vector<size_t> MeasureMemory(const std::vector<size_t>& elements_count);
+		size_t MeasureMemoryPerOrder(size_t count);
 
 		std::vector<std::vector<size_t>> MeasureConcurrentThreads();
 
 		size_t MeasureConcurrentThreadsAdd(size_t count, size_t half_range);
-		size_t MeasureConcurrentThreadsRemove(size_t count, size_t half_range);
-		size_t MeasureConcurrentThreadsChange(size_t count, size_t half_range);
+		size_t MeasureConcurrentThreadsRemove(size_t count, size_t half_range, int thread_count = 0);
+		size_t MeasureConcurrentThreadsChange(size_t count, size_t half_range, int thread_count = 0);
 		size_t MeasureConcurrentThreadsTop10(size_t count, size_t half_range);
+
+		std::vector<std::vector<size_t>> MeasureConcurrentThreadsScaling(const std::vector<int>& threads, size_t count);
+		std::vector<std::vector<size_t>> MeasureConcurrentReaders();
+		size_t MeasureConcurrentReadersTop10(size_t count, size_t half_range, bool snapshot);
+
+		std::vector<size_t> MeasureManagerZipf(size_t symbols, size_t count, double exponent, size_t workers = 0);
+
+		std::vector<std::vector<size_t>> MeasureMatching(const std::vector<size_t>& elements_count);
+		std::vector<size_t> MeasureStopCascade(size_t levels, size_t stops_per_level);
+		std::vector<size_t> MeasureExpiry(size_t count, uint64_t ticks);
+		std::vector<size_t> MeasureSweep(size_t levels, size_t orders_per_level);
+		std::vector<size_t> MeasureLevelUpdates(size_t count);
+		size_t MeasureOneThreadMatchingAdd(size_t count, bool matching, size_t& fills);
+		std::vector<std::vector<size_t>> MeasureSelfTrade(const std::vector<size_t>& elements_count);
+		size_t MeasureOneThreadSelfTrade(size_t count, SelfTrade self_trade);
+		std::vector<std::vector<size_t>> MeasureUncross(const std::vector<size_t>& elements_count);
+		std::vector<std::vector<size_t>> MeasureDepthQueries(const std::vector<size_t>& elements_count);
+		std::vector<size_t> MeasureSnapshotReaders(size_t count, int readers);
+		std::vector<size_t> MeasureOrderEvents(size_t count);
 	
 	
 	private:
 	
 		Order GenerateRandomOrder(std::normal_distribution<double>& price_int_dist);
 		std::vector<Order> GenerateOrders(size_t max_size, std::normal_distribution<double>& price_int_dist);
+		size_t ResidentMemory();
 	
 		template<template<typename> class Comparator>
 		std::vector<Order> GetTop10(const std::vector<Order>& v_mix, Type type){
@@ -71,6 +131,18 @@ namespace OrderBook{
 			}
 			return {v.begin(), std::min(v.end(), v.begin()+10)};
 		}
+
+		template<template<typename> class Comparator>
+		std::vector<Order> GetTopN(const std::vector<Order>& v_mix, Type type, size_t n){
+			std::vector<Order> v;
+			for(auto x: v_mix){
+				if(x.type_ == type) v.push_back(x);
+			}
+			n = std::min(n, v.size());
+			std::partial_sort(v.begin(), v.begin() + n, v.end(), Comparator<Order>{});
+			v.resize(n);
+			return v;
+		}
 	
 	private:
 
@@ -83,7 +155,7 @@ namespace OrderBook{
 
 
 	template <typename OrderBookImpl>
-	OrderBookTesting<OrderBookImpl>::OrderBookTesting(): mt_(rd_()), id_dist_(1,1e5),
+	OrderBookTesting<OrderBookImpl>::OrderBookTesting(): mt_(rd_()), id_dist_(1,1e9),
 						count_dist_(1,2e4), price_frac_dist_(0, 99){}
 
 	template <typename OrderBookImpl>
@@ -98,6 +170,7 @@ namespace OrderBook{
 		TestEraseAndTop10();
 		TestChangeAndTop10();
 		TestInsertEraseChangeTop10();
+		TestShowTopN();
 	}
 
 	template <typename OrderBookImpl>
@@ -251,6 +324,99 @@ namespace OrderBook{
 		std::cout << "TestChangeAndTop10 passed!" << std::endl;
 	}
 
+	//ShowTopN at several depths, into buffers as large as the depth and into ones
+	//half as large, which must cut the answer short; ShowTop<N> must agree with ShowTop10.
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::TestShowTopN(){
+
+		for(int i = 0; i < 1000; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)/100 + 1));
+			std::vector orders = GenerateOrders(1000, price_int_dist);
+
+			OrderBookImpl obj;
+			for(auto x: orders){
+				obj.Add(x);
+			}
+
+			bool valid = true;
+			for(size_t n: {size_t{0}, size_t{1}, size_t{5}, size_t{10}, size_t{50}, std::uniform_int_distribution<size_t>(0, 600)(mt_)}){
+				for(size_t capacity: {n, n/2}){
+					std::vector<Order> bids(capacity);
+					std::vector<Order> asks(capacity);
+					TopSizes sizes = obj.ShowTopN(n, bids, asks);
+					std::vector<Order> top_bids = GetTopN<std::greater>(orders, Type::BUY, capacity);
+					std::vector<Order> top_asks = GetTopN<std::less>(orders, Type::SELL, capacity);
+					valid &= sizes.bids_ == top_bids.size() && std::equal(top_bids.begin(), top_bids.end(), bids.begin());
+					valid &= sizes.asks_ == top_asks.size() && std::equal(top_asks.begin(), top_asks.end(), asks.begin());
+				}
+			}
+
+			auto top10 = obj.ShowTop10();
+			auto top = obj.template ShowTop<10>();
+			valid &= std::equal(top10.top10_bids_.begin(), top10.top10_bids_.end(), top.bids_.begin(), top.bids_.begin() + top.bids_size_);
+			valid &= std::equal(top10.top10_asks_.begin(), top10.top10_asks_.end(), top.asks_.begin(), top.asks_.begin() + top.asks_size_);
+
+			if(!valid){
+				std::cerr << "ShowTopN random depths 1000" << std::endl;
+				return;
+			}
+		}
+
+		std::cout << "TestShowTopN passed!" << std::endl;
+	}
+
+	//40% of the orders are reduced at their price, 30% get a new random price and
+	//size, all through Modify; half of the rest is reduced through Reduce. Reduce
+	//must refuse a size that is not smaller. The top must match the amended orders.
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::TestModifyAndTop10(){
+
+		for(int i = 0; i < 1000; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)/100 + 1));
+			std::vector orders = GenerateOrders(1000, price_int_dist);
+
+			OrderBookImpl obj;
+			for(auto x: orders){
+				obj.Add(x);
+			}
+
+			std::uniform_int_distribution<int> action_dist(0, 9);
+			bool refused = true;
+			for(auto& x: orders){
+				int action = action_dist(mt_);
+				if(action < 4 && x.count_.val_ > 1){
+					x.count_.val_ = std::uniform_int_distribution<size_t>(1, x.count_.val_ - 1)(mt_);
+					obj.Modify(x);
+				}else if(action < 7){
+					Order changed_order = GenerateRandomOrder(price_int_dist);
+					changed_order.id_ = x.id_;
+					x = changed_order;
+					obj.Modify(x);
+				}else if(action < 8){
+					refused &= !obj.Reduce(x.id_.val_, x.count_.val_);
+					if(x.count_.val_ > 1){
+						x.count_.val_ /= 2;
+						obj.Reduce(x.id_.val_, x.count_.val_);
+					}
+				}
+			}
+
+			std::vector<Order> top10 = GetTop10<std::greater>(orders, Type::BUY);
+			std::list<Order> top10_bids_list{top10.begin(), top10.end()};
+			top10 = GetTop10<std::less>(orders, Type::SELL);
+			std::list<Order> top10_asks_list{top10.begin(), top10.end()};
+
+			auto result = obj.ShowTop10();
+
+			if(!refused || (result.top10_asks_ !=  top10_asks_list) || (result.top10_bids_ != top10_bids_list)){
+						std::cerr << "Modify random orders 1000" << std::endl;
+						return;
+			}
+		}
+
+		std::cout << "TestModifyAndTop10 passed!" << std::endl;
+	}
+
 	template <typename OrderBookImpl>
 	void OrderBookTesting<OrderBookImpl>::TestInsertEraseChangeTop10(){
 
@@ -317,178 +483,1129 @@ namespace OrderBook{
 		std::cout << "TestInsertEraseChangeTop10 passed!" << std::endl;
 	}
 
-
 	template <typename OrderBookImpl>
-	void OrderBookTesting<OrderBookImpl>::ConcurrentTestAddAndTop10(){
+	void OrderBookTesting<OrderBookImpl>::TestAddAndTopLevels(){
 
 		for(int i = 0; i < 1000; ++i){
 			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
-			auto orders = GenerateOrders(10000, price_int_dist);
-			std::vector<Order> top10 = GetTop10<std::greater>(orders, Type::BUY);
-			std::list<Order> top10_bids_list{top10.begin(), top10.end()};
-			top10 = GetTop10<std::less>(orders, Type::SELL);
-			std::list<Order> top10_asks_list{top10.begin(), top10.end()};
+			std::vector orders = GenerateOrders(1000, price_int_dist);
+			for(auto& x: orders){
+				x.price_.integer_part_ %= 20;
+			}
+
+			std::map<size_t, std::pair<size_t, size_t>, std::greater<size_t>> bid_levels;
+			std::map<size_t, std::pair<size_t, size_t>, std::less<size_t>> ask_levels;
+			for(auto x: orders){
+				auto& level = x.type_ == Type::BUY ? bid_levels[ToTicks(x.price_)] : ask_levels[ToTicks(x.price_)];
+				level.first += x.count_.val_;
+				++level.second;
+			}
 
 			OrderBookImpl obj;
 
 			unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
 			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
 
-
-			int t_count = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
-			std::barrier sync_point(t_count);
-			std::vector<std::thread> threads;
-			threads.reserve(t_count);
-			for(int t = 0; t < t_count; ++t){
-				threads.emplace_back([&orders,&obj,&sync_point,t,t_count](){
-					int size = static_cast<int>(orders.size());
-					sync_point.arrive_and_wait();
-					for(int i = t; i <  size; i+=t_count){
-						obj.Add(orders[i]);
-						//std::cout << std::this_thread::get_id() << std::endl;
+			for(auto x: orders){
+				obj.Add(x);
+			}
+			auto result = obj.ShowTopLevels(10);
+
+			auto same = [](const auto& levels, const auto& expected){
+				auto It = expected.begin();
+				for(const auto& level: levels){
+					if(It == expected.end() || ToTicks(level.price_) != It->first ||
+							level.quantity_.val_ != It->second.first || level.orders_ != It->second.second){
+						return false;
 					}
+					++It;
+				}
+				return levels.size() == std::min<size_t>(10, expected.size());
+			};
+
+			if(!same(result.bids_, bid_levels) || !same(result.asks_, ask_levels)){
+					std::cerr << "Add random both types, top levels 1000" << std::endl;
+					return;
+			}
+
+		}
+
+		std::cout << "TestAddAndTopLevels passed!" << std::endl;
+	}
+
+
+	//Feeds random orders into a book in matching mode. After every Add the book must
+	//not be crossed, and in the end an order must still rest exactly when the fills
+	//it took part in did not exhaust it.
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::TestMatching(){
+
+		for(int i = 0; i < 1000; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)/100 + 1));
+			std::vector orders = GenerateOrders(1000, price_int_dist);
+
+			OrderBookImpl obj(true);
+			std::unordered_map<uint64_t, size_t> filled;
+			bool valid_fills = true;
+
+			for(const auto& x: orders){
+				obj.Add(x, [&filled, &valid_fills, &x](const Fill& fill){
+					filled[fill.maker_.val_] += fill.count_.val_;
+					filled[fill.taker_.val_] += fill.count_.val_;
+					valid_fills &= fill.taker_ == x.id_ && (x.type_ == Type::BUY ? !(fill.price_ > x.price_) : !(fill.price_ < x.price_));
 				});
+				auto result = obj.ShowTop10();
+				if(!valid_fills || (!result.top10_bids_.empty() && !result.top10_asks_.empty() &&
+									!(result.top10_bids_.front().price_ < result.top10_asks_.front().price_))){
+					std::cerr << "Matching crossed book or bad fill" << std::endl;
+					return;
+				}
 			}
 
-			for(auto& t: threads){
-				t.join();
+			for(const auto& x: orders){
+				size_t done = filled[x.id_.val_];
+				if(done > x.count_.val_ || obj.Remove(x.id_.val_) != (done < x.count_.val_)){
+					std::cerr << "Matching quantities" << std::endl;
+					return;
+				}
 			}
+		}
 
-			auto result = obj.ShowTop10();
+		std::cout << "TestMatching passed!" << std::endl;
+	}
 
-			if((result.top10_bids_ != top10_bids_list) || (result.top10_asks_ != top10_asks_list)){
-					std::cerr <<  "Concurrent Insert random both types 1000" << std::endl;
+	//IOC and FOK orders against a random book in matching mode: neither may rest, and
+	//a FOK either executes its whole size or leaves the book untouched.
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::TestImmediateOrders(){
+
+		for(int i = 0; i < 1000; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)/100 + 1));
+			std::vector orders = GenerateOrders(1000, price_int_dist);
+
+			OrderBookImpl obj(true);
+			for(size_t j = 0; j < orders.size(); ++j){
+				Order x = orders[j];
+				x.flags_ = j % 3 == 0 ? NONE : (j % 3 == 1 ? IOC : FOK);
+				auto before = obj.ShowTop10();
+				size_t filled = 0;
+				bool added = obj.Add(x, [&filled](const Fill& fill){ filled += fill.count_.val_; });
+				if(x.flags_ == NONE){
+					continue;
+				}
+				auto after = obj.ShowTop10();
+				bool untouched = before.top10_bids_ == after.top10_bids_ && before.top10_asks_ == after.top10_asks_;
+				bool fok_ok = x.flags_ != FOK || (added ? filled == x.count_.val_ : filled == 0 && untouched);
+				if(obj.Remove(x.id_.val_) || added != (filled != 0) || !fok_ok){
+					std::cerr << "Immediate orders" << std::endl;
 					return;
+				}
+			}
+		}
 
+		std::cout << "TestImmediateOrders passed!" << std::endl;
+	}
+
+	//Orders of three owners are matched under every self-trade rule and no fill may
+	//pair two orders of one owner. Then a buy of owner 1 meets its own ask ahead of
+	//another owner's ask at the same price and each rule must leave its own result.
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::TestSelfTrade(){
+
+		for(int i = 0; i < 1000; ++i){
+			SelfTrade self_trade = static_cast<SelfTrade>(1 + i % 3);
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)/100 + 1));
+			std::vector orders = GenerateOrders(1000, price_int_dist);
+			std::unordered_map<uint64_t, uint32_t> owners;
+			std::uniform_int_distribution<uint32_t> owner_dist(1, 3);
+
+			OrderBookImpl obj(true, i % 2 == 0, self_trade);
+			bool self_filled = false;
+			for(auto x: orders){
+				x.owner_ = owner_dist(mt_);
+				owners[x.id_.val_] = x.owner_;
+				obj.Add(x, [&](const Fill& fill){ self_filled |= owners[fill.maker_.val_] == owners[fill.taker_.val_]; });
 			}
 
+			size_t k = 1 + i % 50;
+			OrderBookImpl book(true, true, self_trade);
+			Order own(Id(1), Price(100, 0), Count(10*k), Type::SELL);
+			Order other(Id(2), Price(100, 0), Count(10*k), Type::SELL);
+			Order taker(Id(3), Price(100, 0), Count(15*k), Type::BUY);
+			own.owner_ = taker.owner_ = 1;
+			other.owner_ = 2;
+			book.Add(own);
+			book.Add(other);
+			Order fok = taker;
+			fok.id_ = Id(4);
+			fok.flags_ = FOK;
+			size_t filled = 0;
+			bool fok_added = book.Add(fok, [&filled](const Fill& fill){ filled += fill.count_.val_; });
+			book.Add(taker, [&filled](const Fill& fill){ filled += fill.count_.val_; });
+			auto result = book.ShowTop10();
+
+			size_t bid = result.top10_bids_.empty() ? 0 : result.top10_bids_.front().count_.val_;
+			size_t ask = result.top10_asks_.empty() ? 0 : result.top10_asks_.back().count_.val_;
+			bool expected = fok_added ? false :
+				self_trade == SelfTrade::CANCEL_NEWEST ? filled == 0 && bid == 0 && result.top10_asks_.size() == 2 :
+				self_trade == SelfTrade::CANCEL_OLDEST ? filled == 10*k && bid == 5*k && result.top10_asks_.empty() :
+				filled == 5*k && bid == 0 && result.top10_asks_.size() == 1 && ask == 5*k;
+			if(self_filled || !expected){
+				std::cerr << "Self-trade prevention" << std::endl;
+				return;
+			}
 		}
 
-		std::cout << "ConccurentTestAddAndTop10 passed!" << std::endl;
+		std::cout << "TestSelfTrade passed!" << std::endl;
 	}
 
-
+	//Crossing orders collected in an auction must not trade on arrival. The uncross
+	//must execute the largest volume any single price allows, at one price, without
+	//overfilling an order, and leave the book uncrossed. With self-trade prevention
+	//and the orders spread over three owners, no fill may pair two orders of one owner.
 	template <typename OrderBookImpl>
-	void OrderBookTesting<OrderBookImpl>::ConcurrentTestEraseAndTop10(){
+	void OrderBookTesting<OrderBookImpl>::TestAuction(){
 
 		for(int i = 0; i < 1000; ++i){
-			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(i % 20 + 1));
 			std::vector orders = GenerateOrders(1000, price_int_dist);
 
-			OrderBookImpl obj;
+			OrderBookImpl obj(true);
+			obj.StartAuction();
+			size_t traded = 0;
+			std::unordered_map<uint64_t, size_t> left;
+			for(const auto& x: orders){
+				obj.Add(x, [&traded](const Fill&){ ++traded; });
+				left[x.id_.val_] = x.count_.val_;
+			}
 
-			unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
+			size_t expected = 0;
+			for(const auto& p: orders){
+				size_t demand = 0;
+				size_t supply = 0;
+				for(const auto& x: orders){
+					demand += x.type_ == Type::BUY && !(x.price_ < p.price_) ? x.count_.val_ : 0;
+					supply += x.type_ == Type::SELL && !(x.price_ > p.price_) ? x.count_.val_ : 0;
+				}
+				expected = std::max(expected, std::min(demand, supply));
+			}
+
+			auto fills = obj.Uncross();
+			size_t volume = 0;
+			bool valid = traded == 0;
+			for(const auto& fill: fills){
+				volume += fill.count_.val_;
+				valid &= fill.price_ == fills.front().price_;
+				valid &= left[fill.maker_.val_] >= fill.count_.val_ && left[fill.taker_.val_] >= fill.count_.val_;
+				left[fill.maker_.val_] -= fill.count_.val_;
+				left[fill.taker_.val_] -= fill.count_.val_;
+			}
+			auto result = obj.ShowTop10();
+			bool crossed = !result.top10_bids_.empty() && !result.top10_asks_.empty() &&
+										!(result.top10_bids_.front().price_ < result.top10_asks_.front().price_);
+			if(!valid || volume != expected || crossed){
+				std::cerr << "Auction uncross" << std::endl;
+				return;
+			}
 
+			OrderBookImpl guarded(true, false, SelfTrade::DECREMENT_BOTH);
+			guarded.StartAuction();
+			std::unordered_map<uint64_t, uint32_t> owners;
 			for(auto x: orders){
-				obj.Add(x);
+				x.owner_ = 1 + x.id_.val_ % 3;
+				owners[x.id_.val_] = x.owner_;
+				guarded.Add(x);
 			}
+			for(const auto& fill: guarded.Uncross()){
+				valid &= owners[fill.maker_.val_] != owners[fill.taker_.val_];
+			}
+			if(!valid){
+				std::cerr << "Auction self-trade" << std::endl;
+				return;
+			}
+		}
 
-			int t_count = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
-			std::barrier sync_point(t_count);
-			std::vector<std::thread> threads;
-			threads.reserve(t_count);
-			for(int t = 0; t < t_count; ++t){
-				threads.emplace_back([&orders,&obj,&sync_point,t,t_count](){
-					int size = static_cast<int>(orders.size());
-					sync_point.arrive_and_wait();
-					for(int i = t; i <  size; i+=t_count){
-						obj.Remove(orders[i].id_.val_);
+		std::cout << "TestAuction passed!" << std::endl;
+	}
+
+	//Asks rest on consecutive ticks, an iceberg among them. A market buy or a far
+	//limit buy executes what lies within the protection band (everything without
+	//one) up to its size; only the limit buy may rest, and only without a band. A
+	//market sell against no bids is refused.
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::TestMarketOrders(){
+
+		for(int i = 0; i < 1000; ++i){
+			size_t levels = 1 + i % 20;
+			size_t per_level = 1 + i % 5;
+			size_t band = i % 3 == 0 ? 0 : 1 + i % 7;
+			size_t base = 10000;
+			OrderBookImpl obj(true);
+			obj.SetProtectionBand(band);
+
+			uint64_t id = 1;
+			size_t total = 0;
+			size_t within = 0;
+			for(size_t j = 0; j < levels; ++j){
+				for(size_t k = 0; k < per_level; ++k){
+					Order ask(Id(id++), FromTicks(base + j), Count(count_dist_(mt_)), Type::SELL);
+					OrderTerms terms;
+					if(j == 0 && k == 0){
+						terms.peak_ = ask.count_.val_/3 + 1;
 					}
-				});
+					total += ask.count_.val_;
+					within += band == 0 || j <= band ? ask.count_.val_ : 0;
+					obj.Add(ask, terms);
+				}
 			}
 
-			for(auto& t: threads){
-				t.join();
+			std::vector<Fill> fills;
+			Order taker(Id(id++), FromTicks(base + levels + 10), Count(std::uniform_int_distribution<size_t>(1, total + total/5)(mt_)), Type::BUY);
+			bool market = i % 2 == 0;
+			taker.flags_ = market ? MARKET : NONE;
+			size_t executed = obj.Sweep(taker, fills);
+			bool rests = !market && band == 0 && taker.count_.val_ > total;
+			bool valid = executed == std::min(taker.count_.val_, within) && obj.Remove(taker.id_.val_) == rests;
+			for(const auto& fill: fills){
+				valid &= band == 0 || !(fill.price_ > FromTicks(base + band));
 			}
 
-			auto result = obj.ShowTop10();
+			Order sell(Id(id++), Price(0, 0), Count(10), Type::SELL);
+			sell.flags_ = MARKET;
+			valid &= !obj.Add(sell);
+			if(!valid){
+				std::cerr << "Market orders" << std::endl;
+				return;
+			}
+		}
 
-			if((result.top10_asks_.size() !=  0u) || (result.top10_bids_.size() != 0u)){
-						std::cerr << "Concurrent Erase random bids 1000" << std::endl;
-						return;
+		std::cout << "TestMarketOrders passed!" << std::endl;
+	}
+
+	//Two matching books get the same orders, icebergs among them, and lose the same
+	//cancellations. On one, an IOC order up to a random limit must execute exactly
+	//QuantityUpTo; on the other, a market order of a random size must execute what
+	//CostOf promised, with the same notional and worst price.
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::TestDepthQueries(){
+
+		for(int i = 0; i < 1000; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)/1000 + 1));
+			std::vector orders = GenerateOrders(1000, price_int_dist);
+			OrderBookImpl limited(true);
+			OrderBookImpl market(true);
+			std::bernoulli_distribution is_iceberg(0.1);
+			for(const auto& x: orders){
+				OrderTerms terms;
+				if(is_iceberg(mt_)){
+					terms.peak_ = x.count_.val_/4 + 1;
+				}
+				limited.Add(x, terms);
+				market.Add(x, terms);
+			}
+			std::bernoulli_distribution is_removed(0.2);
+			for(const auto& x: orders){
+				if(is_removed(mt_)){
+					limited.Remove(x.id_.val_);
+					market.Remove(x.id_.val_);
+				}
+			}
+
+			Type type = i % 2 == 0 ? Type::BUY : Type::SELL;
+			std::vector<Fill> fills;
+			Order ioc = GenerateRandomOrder(price_int_dist);
+			ioc.type_ = type;
+			ioc.count_ = Count(SIZE_MAX);
+			ioc.flags_ = IOC;
+			size_t up_to = limited.QuantityUpTo(type, ioc.price_);
+			bool valid = limited.Sweep(ioc, fills) == up_to;
+
+			size_t total = market.QuantityUpTo(type, type == Type::BUY ? FromTicks(SIZE_MAX/2) : Price(0, 0));
+			size_t quantity = std::uniform_int_distribution<size_t>(1, total + total/5 + 1)(mt_);
+			FillCost cost = market.CostOf(type, quantity);
+			Order taker(Id(0), Price(0, 0), Count(quantity), type);
+			taker.flags_ = MARKET;
+			size_t executed = market.Sweep(taker, fills);
+			uint64_t notional = 0;
+			size_t worst = type == Type::BUY ? 0 : SIZE_MAX;
+			for(const auto& fill: fills){
+				notional += fill.count_.val_*ToTicks(fill.price_);
+				worst = type == Type::BUY ? std::max(worst, ToTicks(fill.price_)) : std::min(worst, ToTicks(fill.price_));
 			}
+			valid &= executed == cost.quantity_.val_ && executed == std::min(quantity, total) && notional == cost.notional_;
+			valid &= fills.empty() || worst == ToTicks(cost.worst_);
 
+			if(!valid){
+				std::cerr << "Depth queries" << std::endl;
+				return;
+			}
 		}
 
-		std::cout << "ConcurrentTestEraseAndTop10 passed!" << std::endl;
+		std::cout << "TestDepthQueries passed!" << std::endl;
 	}
 
-
+	//Two consumers drain the level feed in batches, each through its own cursor, while
+	//orders are added, removed and changed, and a late joiner takes ShowTopLevels in
+	//the middle of it and then reads the feed after the snapshot's seq_. Each consumer
+	//must get the updates numbered from 1 in order without a gap, and the consumers
+	//and the late joiner must all rebuild exactly the levels of the orders that remain.
 	template <typename OrderBookImpl>
-	void OrderBookTesting<OrderBookImpl>::ConcurrentTestChangeAndTop10(){
+	void OrderBookTesting<OrderBookImpl>::ConcurrentTestLevelUpdates(){
 
 		for(int i = 0; i < 1000; ++i){
-			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)/100 + 1));
 			std::vector orders = GenerateOrders(1000, price_int_dist);
 
 			OrderBookImpl obj;
+			obj.EnableLevelUpdates(4*orders.size());
+			using Levels = std::map<std::pair<Type, size_t>, size_t>;
+			struct Consumer{
+				LevelFeed::Cursor cursor_;
+				Levels levels_;
+				uint64_t seq_ = 0;
+				bool in_order_ = true;
+			};
+			auto apply = [&obj](Consumer& consumer){
+				std::vector<LevelUpdate> batch;
+				obj.DrainLevelUpdates(consumer.cursor_, batch, 64);
+				for(const auto& update: batch){
+					consumer.levels_[{update.side_, ToTicks(update.price_)}] = update.quantity_.val_;
+					consumer.in_order_ &= update.seq_ == ++consumer.seq_;
+				}
+				return !batch.empty();
+			};
 
-			unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
-
-			for(auto x: orders){
-				obj.Add(x);
-			}
-
-			int t_count = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
-			std::barrier sync_point(t_count);
+			std::atomic<bool> done{false};
+			std::vector<Consumer> consumers(2);
 			std::vector<std::thread> threads;
-			threads.reserve(t_count);
-			for(int t = 0; t < t_count; ++t){
-				threads.emplace_back([&orders,&obj,&sync_point,t,t_count](){
-					int size = static_cast<int>(orders.size());
-					sync_point.arrive_and_wait();
-					for(int i = t; i <  size; i+=t_count){
-						orders[i].price_ = std::move(Price(static_cast<uint64_t>(t),10));
-						obj.Change(orders[i]);
+			for(auto& consumer: consumers){
+				threads.emplace_back([&apply, &done, &consumer](){
+					while(!done.load()){
+						apply(consumer);
 					}
 				});
 			}
 
+			Consumer late;
+			for(size_t j = 0; j < orders.size(); ++j){
+				obj.Add(orders[j]);
+				if(j == orders.size()/2){
+					auto snapshot = obj.ShowTopLevels(SIZE_MAX);
+					late.cursor_ = LevelFeed::Cursor(snapshot.seq_);
+					late.seq_ = snapshot.seq_;
+					for(const auto& level: snapshot.bids_){
+						late.levels_[{Type::BUY, ToTicks(level.price_)}] = level.quantity_.val_;
+					}
+					for(const auto& level: snapshot.asks_){
+						late.levels_[{Type::SELL, ToTicks(level.price_)}] = level.quantity_.val_;
+					}
+				}
+			}
+			for(size_t j = 0; j < orders.size(); j += 3){
+				obj.Remove(orders[j].id_.val_);
+			}
+			for(size_t j = 1; j < orders.size(); j += 3){
+				Order changed_order = GenerateRandomOrder(price_int_dist);
+				changed_order.id_ = orders[j].id_;
+				orders[j] = changed_order;
+				obj.Change(orders[j]);
+			}
+			done.store(true);
 			for(auto& t: threads){
 				t.join();
 			}
+			consumers.push_back(std::move(late));
+			for(auto& consumer: consumers){
+				while(apply(consumer));
+			}
 
+			std::map<std::pair<Type, size_t>, size_t> expected;
+			for(size_t j = 0; j < orders.size(); ++j){
+				if(j % 3 != 0){
+					expected[{orders[j].type_, ToTicks(orders[j].price_)}] += orders[j].count_.val_;
+				}
+			}
+			bool valid = true;
+			for(auto& consumer: consumers){
+				std::erase_if(consumer.levels_, [](const auto& level){ return level.second == 0; });
+				valid &= consumer.in_order_ && consumer.cursor_.Missed() == 0 && consumer.levels_ == expected;
+			}
+			if(!valid){
+				std::cerr << "Level updates" << std::endl;
+				return;
+			}
+		}
 
-			std::vector<Order> top10 = GetTop10<std::greater>(orders, Type::BUY);
-			std::list<Order> top10_bids_list{top10.begin(), top10.end()};
-			top10 = GetTop10<std::less>(orders, Type::SELL);
-			std::list<Order> top10_asks_list{top10.begin(), top10.end()};
+		std::cout << "ConcurrentTestLevelUpdates passed!" << std::endl;
+	}
 
-			auto result = obj.ShowTop10();
+	//An iceberg that arrived first shows only its peak, goes behind the other orders
+	//of its price once the first slice is executed, and a sweep of the whole level
+	//executes its reserve too. An iceberg amended to a larger size must still show
+	//only its peak.
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::TestIceberg(){
 
-			if((result.top10_asks_ !=  top10_asks_list) || (result.top10_bids_ != top10_bids_list)){
-						std::cerr << "Concurrent Change random bids 1000" << std::endl;
-						return;
+		for(int i = 0; i < 1000; ++i){
+			size_t peak = count_dist_(mt_);
+			size_t total = peak*(2 + i % 5) + i % 7;
+			Order iceberg(Id(1), Price(100, 0), Count(total), Type::SELL);
+			OrderTerms terms;
+			terms.peak_ = peak;
+
+			OrderBookImpl obj(true, true);
+			obj.Add(iceberg, terms);
+			size_t others = 0;
+			for(uint64_t id = 2; id < 6; ++id){
+				size_t count = count_dist_(mt_);
+				others += count;
+				obj.Add(Order(Id(id), Price(100, 0), Count(count), Type::SELL));
+			}
+
+			auto asks = obj.ShowTop10().top10_asks_;
+			if(asks.size() != 5 || asks.front().id_.val_ != 1 || asks.front().count_.val_ != peak){
+				std::cerr << "Iceberg display" << std::endl;
+				return;
+			}
+
+			size_t filled = 0;
+			obj.Add(Order(Id(10), Price(100, 0), Count(peak), Type::BUY), [&filled](const Fill& fill){ filled += fill.count_.val_; });
+			asks = obj.ShowTop10().top10_asks_;
+			if(filled != peak || asks.size() != 5 || asks.back().id_.val_ != 1 || asks.back().count_.val_ != std::min(peak, total - peak)){
+				std::cerr << "Iceberg refill" << std::endl;
+				return;
+			}
+
+			filled = 0;
+			obj.Add(Order(Id(11), Price(100, 0), Count(total + others), Type::BUY), [&filled](const Fill& fill){ filled += fill.count_.val_; });
+			auto result = obj.ShowTop10();
+			if(filled != total - peak + others || !result.top10_asks_.empty() || result.top10_bids_.front().count_.val_ != peak){
+				std::cerr << "Iceberg sweep" << std::endl;
+				return;
 			}
 
+			OrderBookImpl amended(true, true);
+			amended.Add(iceberg, terms);
+			Order larger = iceberg;
+			larger.count_.val_ = 2*total;
+			bool modified = amended.Modify(larger);
+			asks = amended.ShowTop10().top10_asks_;
+			if(!modified || asks.size() != 1 || asks.front().count_.val_ != peak){
+				std::cerr << "Iceberg amend" << std::endl;
+				return;
+			}
 		}
 
-		std::cout << "ConcurrentTestChangeAndTop10 passed!" << std::endl;
+		std::cout << "TestIceberg passed!" << std::endl;
 	}
 
-
+	//Asks rest one per tick above a start price and a buy stop waits at every ask
+	//price. One trade at the start price must set off a cascade that clears the
+	//asks, while sell stops below the start price stay parked until removed.
 	template <typename OrderBookImpl>
-	std::vector<std::vector<size_t>> OrderBookTesting<OrderBookImpl>::MeasureOneThread(){
-		OrderBookImpl obj;
+	void OrderBookTesting<OrderBookImpl>::TestStopOrders(){
 
-		std::vector<size_t> elements_count = {1000, 5000, 10000, 50000};
-		std::vector<std::vector<size_t>> result;
-		result.resize(4);
+		for(int i = 0; i < 1000; ++i){
+			size_t levels = 1 + i % 50;
+			size_t base = 10000;
+			OrderBookImpl obj;
+			for(size_t j = 0; j < levels; ++j){
+				obj.Add(Order(Id(j + 1), FromTicks(base + j), Count(10), Type::SELL));
+				Order stop(Id(1000 + j), FromTicks(base + j), Count(10), Type::BUY);
+				stop.flags_ = j % 2 == 0 ? STOP : STOP_LIMIT;
+				stop.price_ = FromTicks(base + j + 1);
+				OrderTerms terms;
+				terms.stop_ = FromTicks(base + j);
+				obj.Add(stop, terms);
+			}
+			Order sell_stop(Id(5000), FromTicks(base - 10), Count(10), Type::SELL);
+			sell_stop.flags_ = STOP;
+			OrderTerms sell_terms;
+			sell_terms.stop_ = FromTicks(base - 5);
+			obj.Add(sell_stop, sell_terms);
 
-		for(size_t count: elements_count){
-			result[0].push_back(MeasureOneThreadAdd(count, 500));
-			result[1].push_back(MeasureOneThreadRemove(count, 500));
-			result[2].push_back(MeasureOneThreadChange(count, 500));
-			result[3].push_back(MeasureOneThreadTop10(count, 500));
+			size_t filled = 0;
+			obj.Add(Order(Id(6000), FromTicks(base), Count(10), Type::BUY), [&filled](const Fill& fill){ filled += fill.count_.val_; });
+
+			auto result = obj.ShowTop10();
+			if(filled != 10*levels || !result.top10_asks_.empty() || obj.Parked() != 1 || !obj.Remove(5000) || obj.Parked() != 0){
+				std::cerr << "Stop orders cascade" << std::endl;
+				return;
+			}
 		}
 
-		return result;
+		std::cout << "TestStopOrders passed!" << std::endl;
 	}
 
+	//30% of the orders get an expiry time, some orders are cancelled before they
+	//expire, some are amended to a larger size and time advances in random steps.
+	//Every step must remove exactly the live orders that expired in it, and in the
+	//end exactly the orders without an expiry or with a later one must still rest.
 	template <typename OrderBookImpl>
-	size_t OrderBookTesting<OrderBookImpl>::MeasureOneThreadAdd(size_t count, size_t half_range){
+	void OrderBookTesting<OrderBookImpl>::TestExpiry(){
+
+		for(int i = 0; i < 1000; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+			auto orders = GenerateOrders(1000, price_int_dist);
+			std::bernoulli_distribution expires(0.3);
+			std::uniform_int_distribution<uint64_t> expiry_dist(1, 100000);
+			OrderBookImpl obj;
+			std::vector<uint64_t> expiries(orders.size());
+			for(size_t j = 0; j < orders.size(); ++j){
+				expiries[j] = expires(mt_) ? expiry_dist(mt_) : 0;
+				OrderTerms terms;
+				terms.expiry_ = expiries[j];
+				obj.Add(orders[j], terms);
+			}
+			for(size_t j = 0; j < orders.size(); j += 10){
+				obj.Remove(orders[j].id_.val_);
+			}
+			for(size_t j = 5; j < orders.size(); j += 10){
+				orders[j].count_.val_ += 1;
+				obj.Modify(orders[j]);
+			}
+
+			std::uniform_int_distribution<uint64_t> step_dist(1, 30000);
+			uint64_t now = 0;
+			for(int step = 0; step < 3; ++step){
+				uint64_t next = now + step_dist(mt_);
+				size_t expected = 0;
+				for(size_t j = 0; j < orders.size(); ++j){
+					expected += j % 10 != 0 && expiries[j] > now && expiries[j] <= next;
+				}
+				now = next;
+				if(obj.ExpireOrders(now) != expected){
+					std::cerr << "Expiry count" << std::endl;
+					return;
+				}
+			}
+			for(size_t j = 0; j < orders.size(); ++j){
+				bool rests = j % 10 != 0 && (expiries[j] == 0 || expiries[j] > now);
+				if(obj.Remove(orders[j].id_.val_) != rests){
+					std::cerr << "Expiry" << std::endl;
+					return;
+				}
+			}
+		}
+
+		std::cout << "TestExpiry passed!" << std::endl;
+	}
+
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::ConcurrentTestAddAndTop10(){
+
+		for(int i = 0; i < 1000; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+			auto orders = GenerateOrders(10000, price_int_dist);
+			std::vector<Order> top10 = GetTop10<std::greater>(orders, Type::BUY);
+			std::list<Order> top10_bids_list{top10.begin(), top10.end()};
+			top10 = GetTop10<std::less>(orders, Type::SELL);
+			std::list<Order> top10_asks_list{top10.begin(), top10.end()};
+
+			OrderBookImpl obj;
+
+			unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
+
+
+			int t_count = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+			std::barrier sync_point(t_count);
+			std::vector<std::thread> threads;
+			threads.reserve(t_count);
+			for(int t = 0; t < t_count; ++t){
+				threads.emplace_back([&orders,&obj,&sync_point,t,t_count](){
+					int size = static_cast<int>(orders.size());
+					sync_point.arrive_and_wait();
+					for(int i = t; i <  size; i+=t_count){
+						obj.Add(orders[i]);
+						//std::cout << std::this_thread::get_id() << std::endl;
+					}
+				});
+			}
+
+			for(auto& t: threads){
+				t.join();
+			}
+
+			auto result = obj.ShowTop10();
+
+			if((result.top10_bids_ != top10_bids_list) || (result.top10_asks_ != top10_asks_list)){
+					std::cerr <<  "Concurrent Insert random both types 1000" << std::endl;
+					return;
+
+			}
+
+		}
+
+		std::cout << "ConccurentTestAddAndTop10 passed!" << std::endl;
+	}
+
+
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::ConcurrentTestEraseAndTop10(){
+
+		for(int i = 0; i < 1000; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+			std::vector orders = GenerateOrders(1000, price_int_dist);
+
+			OrderBookImpl obj;
+
+			unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
+
+			for(auto x: orders){
+				obj.Add(x);
+			}
+
+			int t_count = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+			std::barrier sync_point(t_count);
+			std::vector<std::thread> threads;
+			threads.reserve(t_count);
+			for(int t = 0; t < t_count; ++t){
+				threads.emplace_back([&orders,&obj,&sync_point,t,t_count](){
+					int size = static_cast<int>(orders.size());
+					sync_point.arrive_and_wait();
+					for(int i = t; i <  size; i+=t_count){
+						obj.Remove(orders[i].id_.val_);
+					}
+				});
+			}
+
+			for(auto& t: threads){
+				t.join();
+			}
+
+			auto result = obj.ShowTop10();
+
+			if((result.top10_asks_.size() !=  0u) || (result.top10_bids_.size() != 0u)){
+						std::cerr << "Concurrent Erase random bids 1000" << std::endl;
+						return;
+			}
+
+		}
+
+		std::cout << "ConcurrentTestEraseAndTop10 passed!" << std::endl;
+	}
+
+
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::ConcurrentTestChangeAndTop10(){
+
+		for(int i = 0; i < 1000; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+			std::vector orders = GenerateOrders(1000, price_int_dist);
+
+			OrderBookImpl obj;
+
+			unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
+
+			for(auto x: orders){
+				obj.Add(x);
+			}
+
+			int t_count = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+			std::barrier sync_point(t_count);
+			std::vector<std::thread> threads;
+			threads.reserve(t_count);
+			for(int t = 0; t < t_count; ++t){
+				threads.emplace_back([&orders,&obj,&sync_point,t,t_count](){
+					int size = static_cast<int>(orders.size());
+					sync_point.arrive_and_wait();
+					for(int i = t; i <  size; i+=t_count){
+						orders[i].price_ = std::move(Price(static_cast<uint64_t>(t),10));
+						obj.Change(orders[i]);
+					}
+				});
+			}
+
+			for(auto& t: threads){
+				t.join();
+			}
+
+
+			std::vector<Order> top10 = GetTop10<std::greater>(orders, Type::BUY);
+			std::list<Order> top10_bids_list{top10.begin(), top10.end()};
+			top10 = GetTop10<std::less>(orders, Type::SELL);
+			std::list<Order> top10_asks_list{top10.begin(), top10.end()};
+
+			auto result = obj.ShowTop10();
+
+			if((result.top10_asks_ !=  top10_asks_list) || (result.top10_bids_ != top10_bids_list)){
+						std::cerr << "Concurrent Change random bids 1000" << std::endl;
+						return;
+			}
+
+		}
+
+		std::cout << "ConcurrentTestChangeAndTop10 passed!" << std::endl;
+	}
+
+
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::ConcurrentTestAddAndSnapshotTop10(){
+
+		for(int i = 0; i < 1000; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+			auto orders = GenerateOrders(1000, price_int_dist);
+			std::vector<Order> top10 = GetTop10<std::greater>(orders, Type::BUY);
+			std::list<Order> top10_bids_list{top10.begin(), top10.end()};
+			top10 = GetTop10<std::less>(orders, Type::SELL);
+			std::list<Order> top10_asks_list{top10.begin(), top10.end()};
+
+			OrderBookImpl obj;
+
+			unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
+
+			int t_count = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+			std::barrier sync_point(t_count);
+			std::vector<std::thread> threads;
+			threads.reserve(t_count);
+			for(int t = 0; t < t_count; ++t){
+				threads.emplace_back([&orders,&obj,&sync_point,t,t_count](){
+					int size = static_cast<int>(orders.size());
+					sync_point.arrive_and_wait();
+					for(int i = t; i <  size; i+=t_count){
+						obj.Add(orders[i]);
+						obj.ShowTop10Snapshot();
+					}
+				});
+			}
+
+			for(auto& t: threads){
+				t.join();
+			}
+
+			auto result = obj.ShowTop10Snapshot();
+			std::list<Order> bids{result.top10_bids_.begin(), result.top10_bids_.begin() + result.bids_size_};
+			std::list<Order> asks{result.top10_asks_.begin(), result.top10_asks_.begin() + result.asks_size_};
+
+			if((bids != top10_bids_list) || (asks != top10_asks_list)){
+					std::cerr <<  "Concurrent Insert random both types, snapshot 1000" << std::endl;
+					return;
+
+			}
+
+		}
+
+		std::cout << "ConcurrentTestAddAndSnapshotTop10 passed!" << std::endl;
+	}
+
+
+	//One writer adds orders into a publisher that snapshots every 50 writes while
+	//consumers poll it. Every snapshot a consumer gets must be newer than its previous
+	//one and hold exactly the top of the writes it counts. A second publisher on a 1 ms
+	//timer must catch up with all writes once they stop.
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::ConcurrentTestSnapshotPublisher(){
+
+		for(int i = 0; i < 1000; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+			auto orders = GenerateOrders(1000, price_int_dist);
+			size_t depth = 10;
+			size_t every = 50;
+
+			OrderBookImpl obj(depth, every);
+			OrderBookImpl timed(depth, 0, std::chrono::microseconds(1000));
+
+			int r_count = std::max(2, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+			std::atomic<bool> done{false};
+			std::vector<std::vector<std::shared_ptr<const BookSnapshot>>> received(r_count);
+			std::vector<std::thread> threads;
+			threads.reserve(r_count);
+			for(int t = 0; t < r_count; ++t){
+				threads.emplace_back([&obj,&done,&received,t](){
+					typename OrderBookImpl::Consumer consumer(obj);
+					bool last = false;
+					while(!last){
+						last = done.load();
+						if(auto snapshot = consumer.Poll()){
+							received[t].push_back(std::move(snapshot));
+						}
+					}
+				});
+			}
+
+			std::vector<Order> accepted;
+			for(const auto& x: orders){
+				if(obj.Add(x)){
+					accepted.push_back(x);
+				}
+				timed.Add(x);
+			}
+			done.store(true);
+			for(auto& t: threads){
+				t.join();
+			}
+
+			bool valid = obj.Latest() && obj.Latest()->version_ == accepted.size()/every;
+			for(const auto& snapshots: received){
+				uint64_t version = 0;
+				for(const auto& snapshot: snapshots){
+					std::vector<Order> prefix(accepted.begin(), accepted.begin() + snapshot->updates_);
+					valid &= snapshot->version_ > version && snapshot->updates_ == snapshot->version_*every;
+					valid &= snapshot->bids_ == GetTopN<std::greater>(prefix, Type::BUY, depth);
+					valid &= snapshot->asks_ == GetTopN<std::less>(prefix, Type::SELL, depth);
+					version = snapshot->version_;
+				}
+			}
+
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+			while(!(timed.Latest() && timed.Latest()->updates_ == accepted.size()) && std::chrono::steady_clock::now() < deadline){
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			}
+			auto latest = timed.Latest();
+			valid &= latest && latest->updates_ == accepted.size() &&
+					latest->bids_ == GetTopN<std::greater>(accepted, Type::BUY, depth) &&
+					latest->asks_ == GetTopN<std::less>(accepted, Type::SELL, depth);
+
+			if(!valid){
+				std::cerr << "Snapshot publisher 1000" << std::endl;
+				return;
+			}
+		}
+
+		std::cout << "ConcurrentTestSnapshotPublisher passed!" << std::endl;
+	}
+
+	//Two consumers drain the order feed, each through its own cursor, while orders are
+	//added, removed, changed, reduced and modified, and a late joiner walks a snapshot
+	//of the book in small chunks in the middle of it and then reads the feed from the
+	//snapshot's Seq(). Each consumer must get every event, numbered from 1 without a
+	//gap, and rebuild exactly the orders that remain, as must the snapshot followed by
+	//the events after it. A cursor that fell behind a small log must see the events it
+	//lost as a gap in the numbers and in Missed().
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::ConcurrentTestOrderEvents(){
+
+		for(int i = 0; i < 1000; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)/100 + 1));
+			std::vector orders = GenerateOrders(1000, price_int_dist);
+
+			OrderBookImpl obj;
+			obj.EnableOrderEvents(8*orders.size());
+			using Book = std::map<uint64_t, Order>;
+			auto apply = [](Book& book, const OrderEvent& event){
+				if(event.kind_ == OrderEvent::Kind::CANCEL){
+					book.erase(event.order_.id_.val_);
+				}else{
+					book[event.order_.id_.val_] = event.order_;
+				}
+			};
+
+			std::atomic<bool> done{false};
+			std::vector<OrderFeed::Cursor> cursors(2);
+			std::vector<std::vector<OrderEvent>> events(2);
+			std::vector<std::thread> consumers;
+			for(size_t c = 0; c < cursors.size(); ++c){
+				consumers.emplace_back([&obj, &done, &cursor = cursors[c], &consumed = events[c]](){
+					while(!done.load()){
+						obj.DrainOrderEvents(cursor, consumed, 64);
+					}
+				});
+			}
+
+			std::atomic<bool> joined{false};
+			Book snapshot;
+			uint64_t snapshot_seq = 0;
+			std::thread late([&](){
+				while(!joined.load()){
+					std::this_thread::yield();
+				}
+				auto cursor = obj.SnapshotOrders();
+				snapshot_seq = cursor.Seq();
+				std::array<Order, 16> chunk;
+				while(size_t count = cursor.Next(chunk)){
+					for(size_t j = 0; j < count; ++j){
+						snapshot[chunk[j].id_.val_] = chunk[j];
+					}
+				}
+			});
+
+			for(size_t j = 0; j < orders.size(); ++j){
+				obj.Add(orders[j]);
+				if(j == orders.size()/2){
+					joined.store(true);
+				}
+			}
+			for(size_t j = 0; j < orders.size(); j += 3){
+				obj.Remove(orders[j].id_.val_);
+			}
+			for(size_t j = 1; j < orders.size(); j += 3){
+				Order changed_order = GenerateRandomOrder(price_int_dist);
+				changed_order.id_ = orders[j].id_;
+				orders[j] = changed_order;
+				obj.Change(orders[j]);
+			}
+			for(size_t j = 2; j < orders.size(); j += 3){
+				size_t count = orders[j].count_.val_;
+				if(j % 2 == 0 && obj.Reduce(orders[j].id_.val_, count/2)){
+					orders[j].count_.val_ = count/2;
+				}else if(j % 2 == 1 && count > 1){
+					Order amended = orders[j];
+					amended.count_.val_ = count - 1;
+					if(obj.Modify(amended)){
+						orders[j] = amended;
+					}
+				}
+			}
+			late.join();
+			done.store(true);
+			for(auto& t: consumers){
+				t.join();
+			}
+			for(size_t c = 0; c < cursors.size(); ++c){
+				while(obj.DrainOrderEvents(cursors[c], events[c], 64) != 0);
+			}
+			OrderFeed::Cursor late_cursor(snapshot_seq);
+			std::vector<OrderEvent> late_events;
+			while(obj.DrainOrderEvents(late_cursor, late_events, 64) != 0);
+
+			Book expected;
+			for(size_t j = 0; j < orders.size(); ++j){
+				if(j % 3 != 0){
+					expected[orders[j].id_.val_] = orders[j];
+				}
+			}
+			auto same = [](const Book& left, const Book& right){
+				return std::equal(left.begin(), left.end(), right.begin(), right.end(), [](const auto& l, const auto& r){
+					return l.first == r.first && l.second == r.second && l.second.type_ == r.second.type_;
+				});
+			};
+			bool valid = true;
+			for(size_t c = 0; c < cursors.size(); ++c){
+				Book replayed;
+				valid &= cursors[c].Missed() == 0;
+				for(size_t j = 0; j < events[c].size(); ++j){
+					valid &= events[c][j].seq_ == j + 1;
+					apply(replayed, events[c][j]);
+				}
+				valid &= same(replayed, expected);
+			}
+			valid &= late_cursor.Missed() == 0;
+			for(size_t j = 0; j < late_events.size(); ++j){
+				valid &= late_events[j].seq_ == snapshot_seq + j + 1;
+				apply(snapshot, late_events[j]);
+			}
+			valid &= same(snapshot, expected);
+
+			OrderBookImpl small;
+			small.EnableOrderEvents(64);
+			for(size_t j = 0; j < 200; ++j){
+				small.Add(orders[j]);
+			}
+			OrderFeed::Cursor behind;
+			std::vector<OrderEvent> kept;
+			while(small.DrainOrderEvents(behind, kept, 64) != 0);
+			valid &= behind.Missed() == 200 - 64 && kept.size() == 64 && kept.front().seq_ == 200 - 64 + 1 && kept.back().seq_ == 200;
+			if(!valid){
+				std::cerr << "Order events" << std::endl;
+				return;
+			}
+		}
+
+		std::cout << "ConcurrentTestOrderEvents passed!" << std::endl;
+	}
+
+	//Threads add orders at a few prices concurrently into a book with time priority.
+	//Draining the book through ShowTop10 must give the prices in priority order, and at
+	//each price the orders of one thread must come out in the order it added them.
+	template <typename OrderBookImpl>
+	void OrderBookTesting<OrderBookImpl>::ConcurrentTestTimePriority(){
+
+		for(int i = 0; i < 100; ++i){
+			int t_count = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+			size_t per_thread = 300;
+			std::vector<Order> orders;
+			orders.reserve(t_count*per_thread);
+			for(int t = 0; t < t_count; ++t){
+				for(size_t k = 0; k < per_thread; ++k){
+					orders.emplace_back(Id(t*per_thread + k + 1), Price(100 + k % 3, 0), Count(count_dist_(mt_)),
+										static_cast<Type>(k % 2));
+				}
+			}
+
+			OrderBookImpl obj(false, true);
+
+			std::barrier sync_point(t_count);
+			std::vector<std::thread> threads;
+			threads.reserve(t_count);
+			for(int t = 0; t < t_count; ++t){
+				threads.emplace_back([&orders,&obj,&sync_point,t,per_thread](){
+					sync_point.arrive_and_wait();
+					for(size_t k = 0; k < per_thread; ++k){
+						obj.Add(orders[t*per_thread + k]);
+					}
+				});
+			}
+
+			for(auto& t: threads){
+				t.join();
+			}
+
+			std::vector<Order> bids;
+			std::vector<Order> asks;
+			while(true){
+				auto result = obj.ShowTop10();
+				if(result.top10_bids_.empty() && result.top10_asks_.empty()){
+					break;
+				}
+				for(const auto& x: result.top10_bids_){
+					bids.push_back(x);
+					obj.Remove(x.id_.val_);
+				}
+				for(const auto& x: result.top10_asks_){
+					asks.push_back(x);
+					obj.Remove(x.id_.val_);
+				}
+			}
+
+			auto fifo = [per_thread](const std::vector<Order>& side, auto better){
+				std::map<std::pair<uint64_t, size_t>, uint64_t> last;
+				for(size_t j = 0; j < side.size(); ++j){
+					if(j > 0 && better(side[j].price_, side[j - 1].price_)){
+						return false;
+					}
+					uint64_t thread = (side[j].id_.val_ - 1)/per_thread;
+					uint64_t index = (side[j].id_.val_ - 1)%per_thread;
+					auto [It, inserted] = last.try_emplace({thread, ToTicks(side[j].price_)}, index);
+					if(!inserted && It->second >= index){
+						return false;
+					}
+					It->second = index;
+				}
+				return true;
+			};
+
+			if(bids.size() + asks.size() != orders.size() || !fifo(bids, std::greater<Price>{}) || !fifo(asks, std::less<Price>{})){
+				std::cerr << "Concurrent time priority" << std::endl;
+				return;
+			}
+		}
+
+		std::cout << "ConcurrentTestTimePriority passed!" << std::endl;
+	}
+
+
+	template <typename OrderBookImpl>
+	std::vector<std::vector<size_t>> OrderBookTesting<OrderBookImpl>::MeasureOneThread(const std::vector<size_t>& elements_count){
+		std::vector<std::vector<size_t>> result;
+		result.resize(5);
+
+		for(size_t count: elements_count){
+			result[0].push_back(MeasureOneThreadAdd(count, 500));
+			result[1].push_back(MeasureOneThreadRemove(count, 500));
+			result[2].push_back(MeasureOneThreadChange(count, 500));
+			result[3].push_back(MeasureOneThreadTop10(count, 500));
+			result[4].push_back(MeasureOneThreadCancelBestTop10(count, 500));
+		}
+
+		return result;
+	}
+
+	template <typename OrderBookImpl>
+	size_t OrderBookTesting<OrderBookImpl>::MeasureOneThreadAdd(size_t count, size_t half_range){
 		size_t sum_time = 0;
 		for(int i = 0; i < 1; ++i){
 			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
@@ -511,14 +1628,207 @@ namespace OrderBook{
 			auto stop = std::chrono::high_resolution_clock::now();
 
 
-			sum_time += std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+			sum_time += std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+		}
+		return sum_time/2/half_range;
+	}
+
+
+	template <typename OrderBookImpl>
+	size_t OrderBookTesting<OrderBookImpl>::MeasureOneThreadRemove(size_t count, size_t half_range){
+		size_t sum_time = 0;
+		for(int i = 0; i < 1; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+			std::vector orders = GenerateOrders(count+half_range, price_int_dist);
+
+			OrderBookImpl obj;
+
+			unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
+
+
+			for(size_t i = 0; i < count + half_range; ++i){
+				obj.Add(orders[i]);
+			}
+
+			seed = std::chrono::system_clock::now().time_since_epoch().count();
+			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
+
+			auto start = std::chrono::high_resolution_clock::now();
+			for(size_t i = 0; i < 2*half_range; ++i){
+				obj.Remove(orders[i].id_.val_);
+			}
+			auto stop = std::chrono::high_resolution_clock::now();
+			sum_time += std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+		}
+		return sum_time/2/half_range;
+	}
+
+
+	//Amends of every resting order, 40% of them reductions at the same price and the
+	//rest new prices, through Change and through Modify.
+	template <typename OrderBookImpl>
+	std::vector<std::vector<size_t>> OrderBookTesting<OrderBookImpl>::MeasureAmends(const std::vector<size_t>& elements_count){
+		std::vector<std::vector<size_t>> result;
+		result.resize(2);
+
+		for(size_t count: elements_count){
+			result[0].push_back(MeasureOneThreadAmend(count, false));
+			result[1].push_back(MeasureOneThreadAmend(count, true));
+		}
+
+		return result;
+	}
+
+	template <typename OrderBookImpl>
+	size_t OrderBookTesting<OrderBookImpl>::MeasureOneThreadAmend(size_t count, bool modify){
+		std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)/100 + 1));
+		std::vector orders = GenerateOrders(count, price_int_dist);
+
+		OrderBookImpl obj;
+		for(const auto& x: orders){
+			obj.Add(x);
+		}
+
+		std::bernoulli_distribution is_reduced(0.4);
+		for(auto& x: orders){
+			if(is_reduced(mt_) && x.count_.val_ > 1){
+				x.count_.val_ /= 2;
+			}else{
+				x.price_ = Price(static_cast<size_t>(std::abs(price_int_dist(mt_))), price_frac_dist_(mt_));
+			}
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for(const auto& x: orders){
+			if(modify){
+				obj.Modify(x);
+			}else{
+				obj.Change(x);
+			}
+		}
+		auto stop = std::chrono::high_resolution_clock::now();
+
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()/std::max<size_t>(1, orders.size());
+	}
+
+	template <typename OrderBookImpl>
+	size_t OrderBookTesting<OrderBookImpl>::MeasureOneThreadChange(size_t count, size_t half_range){
+		size_t sum_time = 0;
+		for(int i = 0; i < 1; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+			std::vector orders = GenerateOrders(count+half_range, price_int_dist);
+
+			OrderBookImpl obj;
+
+			unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
+
+
+			for(size_t i = 0; i < count + half_range; ++i){
+				obj.Add(orders[i]);
+			}
+
+			seed = std::chrono::system_clock::now().time_since_epoch().count();
+			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
+			for(size_t i = 0; i < 2*half_range; ++i){
+				orders[i].price_ = Price(i,10);
+			}
+
+			auto start = std::chrono::high_resolution_clock::now();
+			for(size_t i = 0; i < 2*half_range; ++i){
+				obj.Change(orders[i]);
+			}
+			auto stop = std::chrono::high_resolution_clock::now();
+			sum_time += std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+		}
+		return sum_time/2/half_range;
+	}
+
+
+	template <typename OrderBookImpl>
+	size_t OrderBookTesting<OrderBookImpl>::MeasureOneThreadTop10(size_t count, size_t half_range){
+		size_t sum_time = 0;
+		for(int i = 0; i < 1; ++i){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+			std::vector orders = GenerateOrders(count+half_range, price_int_dist);
+
+			OrderBookImpl obj;
+
+			unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
+
+
+			for(size_t i = 0; i < count + half_range; ++i){
+				obj.Add(orders[i]);
+			}
+
+			auto start = std::chrono::high_resolution_clock::now();
+			for(size_t i = 0; i < 2*half_range; ++i){
+				obj.ShowTop10();
+			}
+			auto stop = std::chrono::high_resolution_clock::now();
+			sum_time += std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+		}
+		return sum_time/2/half_range;
+	}
+
+	//Depths 1, 5, 10 and 50 of a book of count orders, read through ShowTopN into
+	//buffers allocated once and through ShowTop<N>, so no query allocates.
+	template <typename OrderBookImpl>
+	std::vector<std::vector<size_t>> OrderBookTesting<OrderBookImpl>::MeasureTopN(size_t count){
+		std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+		std::vector orders = GenerateOrders(count, price_int_dist);
+
+		OrderBookImpl obj;
+		for(const auto& x: orders){
+			obj.Add(x);
+		}
+
+		size_t queries = 1000;
+		std::vector<std::vector<size_t>> result;
+		result.resize(2);
+		for(size_t n: {1, 5, 10, 50}){
+			result[0].push_back(MeasureOneThreadTopN(obj, n, queries));
+		}
+		result[1].push_back(MeasureOneThreadShowTop<1>(obj, queries));
+		result[1].push_back(MeasureOneThreadShowTop<5>(obj, queries));
+		result[1].push_back(MeasureOneThreadShowTop<10>(obj, queries));
+		result[1].push_back(MeasureOneThreadShowTop<50>(obj, queries));
+
+		return result;
+	}
+
+	template <typename OrderBookImpl>
+	size_t OrderBookTesting<OrderBookImpl>::MeasureOneThreadTopN(const OrderBookImpl& obj, size_t n, size_t queries){
+		std::vector<Order> bids(n);
+		std::vector<Order> asks(n);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for(size_t i = 0; i < queries; ++i){
+			obj.ShowTopN(n, bids, asks);
 		}
-		return sum_time/2/half_range;
+		auto stop = std::chrono::high_resolution_clock::now();
+
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()/queries;
 	}
 
+	template <typename OrderBookImpl>
+	template <size_t N>
+	size_t OrderBookTesting<OrderBookImpl>::MeasureOneThreadShowTop(const OrderBookImpl& obj, size_t queries){
+		auto start = std::chrono::high_resolution_clock::now();
+		for(size_t i = 0; i < queries; ++i){
+			obj.template ShowTop<N>();
+		}
+		auto stop = std::chrono::high_resolution_clock::now();
+
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()/queries;
+	}
 
+	//Removes the best bid and the best ask and reads the top after every step, so the
+	//engine has to find the next non-empty price each time.
 	template <typename OrderBookImpl>
-	size_t OrderBookTesting<OrderBookImpl>::MeasureOneThreadRemove(size_t count, size_t half_range){
+	size_t OrderBookTesting<OrderBookImpl>::MeasureOneThreadCancelBestTop10(size_t count, size_t half_range){
 		size_t sum_time = 0;
 		for(int i = 0; i < 1; ++i){
 			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
@@ -526,87 +1836,380 @@ namespace OrderBook{
 
 			OrderBookImpl obj;
 
-			unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
-
-
-			for(size_t i = 0; i < count + half_range; ++i){
-				obj.Add(orders[i]);
+			for(const auto& order: orders){
+				obj.Add(order);
 			}
 
-			seed = std::chrono::system_clock::now().time_since_epoch().count();
-			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
+			std::vector<Order> bids;
+			std::vector<Order> asks;
+			for(const auto& order: orders){
+				(order.type_ == Type::BUY ? bids : asks).push_back(order);
+			}
+			std::sort(bids.begin(), bids.end(), std::greater<Order>{});
+			std::sort(asks.begin(), asks.end(), std::less<Order>{});
 
 			auto start = std::chrono::high_resolution_clock::now();
-			for(size_t i = 0; i < 2*half_range; ++i){
-				obj.Remove(orders[i].id_.val_);
+			for(size_t i = 0; i < half_range; ++i){
+				if(i < bids.size()){
+					obj.Remove(bids[i].id_.val_);
+				}
+				if(i < asks.size()){
+					obj.Remove(asks[i].id_.val_);
+				}
+				obj.ShowTop10();
 			}
 			auto stop = std::chrono::high_resolution_clock::now();
 			sum_time += std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
 		}
-		return sum_time/2/half_range;
+		return sum_time/half_range;
 	}
 
 
+	//Time per Add into an empty book in plain and in matching mode, and the number of
+	//fills the matching run produced.
 	template <typename OrderBookImpl>
-	size_t OrderBookTesting<OrderBookImpl>::MeasureOneThreadChange(size_t count, size_t half_range){
-		size_t sum_time = 0;
-		for(int i = 0; i < 1; ++i){
-			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
-			std::vector orders = GenerateOrders(count+half_range, price_int_dist);
+	std::vector<std::vector<size_t>> OrderBookTesting<OrderBookImpl>::MeasureMatching(const std::vector<size_t>& elements_count){
+		std::vector<std::vector<size_t>> result;
+		result.resize(3);
 
-			OrderBookImpl obj;
+		for(size_t count: elements_count){
+			size_t fills = 0;
+			result[0].push_back(MeasureOneThreadMatchingAdd(count, false, fills));
+			result[1].push_back(MeasureOneThreadMatchingAdd(count, true, fills));
+			result[2].push_back(fills);
+		}
 
-			unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
+		return result;
+	}
 
+	template <typename OrderBookImpl>
+	size_t OrderBookTesting<OrderBookImpl>::MeasureOneThreadMatchingAdd(size_t count, bool matching, size_t& fills){
+		std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)/100 + 1));
+		std::vector orders = GenerateOrders(count, price_int_dist);
 
-			for(size_t i = 0; i < count + half_range; ++i){
-				obj.Add(orders[i]);
+		OrderBookImpl obj(matching);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for(const auto& x: orders){
+			obj.Add(x, [&fills](const Fill&){ ++fills; });
+		}
+		auto stop = std::chrono::high_resolution_clock::now();
+
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()/std::max<size_t>(1, orders.size());
+	}
+
+	//Time per matching Add with self-trade prevention off and under each rule, with
+	//the orders spread over 100 owners.
+	template <typename OrderBookImpl>
+	std::vector<std::vector<size_t>> OrderBookTesting<OrderBookImpl>::MeasureSelfTrade(const std::vector<size_t>& elements_count){
+		std::vector<std::vector<size_t>> result;
+		result.resize(4);
+
+		for(size_t count: elements_count){
+			for(size_t rule = 0; rule < result.size(); ++rule){
+				result[rule].push_back(MeasureOneThreadSelfTrade(count, static_cast<SelfTrade>(rule)));
 			}
+		}
 
-			seed = std::chrono::system_clock::now().time_since_epoch().count();
-			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
-			for(size_t i = 0; i < 2*half_range; ++i){
-				orders[i].price_ = Price(i,10);
+		return result;
+	}
+
+	template <typename OrderBookImpl>
+	size_t OrderBookTesting<OrderBookImpl>::MeasureOneThreadSelfTrade(size_t count, SelfTrade self_trade){
+		std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)/100 + 1));
+		std::vector orders = GenerateOrders(count, price_int_dist);
+		std::uniform_int_distribution<uint32_t> owner_dist(1, 100);
+		for(auto& x: orders){
+			x.owner_ = owner_dist(mt_);
+		}
+
+		OrderBookImpl obj(true, false, self_trade);
+		size_t fills = 0;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for(const auto& x: orders){
+			obj.Add(x, [&fills](const Fill&){ ++fills; });
+		}
+		auto stop = std::chrono::high_resolution_clock::now();
+
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()/std::max<size_t>(1, orders.size());
+	}
+
+
+	//Orders of both sides drawn around one price are collected in an auction and
+	//uncrossed. Returns the uncross time, the number of fills and the time per order.
+	template <typename OrderBookImpl>
+	std::vector<std::vector<size_t>> OrderBookTesting<OrderBookImpl>::MeasureUncross(const std::vector<size_t>& elements_count){
+		std::vector<std::vector<size_t>> result;
+		result.resize(3);
+
+		for(size_t count: elements_count){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)/100 + 1));
+			std::bernoulli_distribution type_dist(0.5);
+			auto obj = std::make_unique<OrderBookImpl>(true);
+			obj->StartAuction();
+			for(size_t j = 0; j < count; ++j){
+				obj->Add(Order(Id(j + 1), Price(static_cast<size_t>(std::abs(price_int_dist(mt_))), price_frac_dist_(mt_)),
+										Count(count_dist_(mt_)), static_cast<Type>(type_dist(mt_))));
 			}
 
 			auto start = std::chrono::high_resolution_clock::now();
-			for(size_t i = 0; i < 2*half_range; ++i){
-				obj.Change(orders[i]);
-			}
+			auto fills = obj->Uncross();
 			auto stop = std::chrono::high_resolution_clock::now();
-			sum_time += std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+
+			size_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+			result[0].push_back(time);
+			result[1].push_back(fills.size());
+			result[2].push_back(time/count);
 		}
-		return sum_time/2/half_range;
+
+		return result;
 	}
 
+	//Asks of levels ticks with orders_per_level orders each, cleared once by one
+	//market order through Sweep and once by removing every order. Returns both times
+	//and the number of fills of the sweep.
+	template <typename OrderBookImpl>
+	std::vector<size_t> OrderBookTesting<OrderBookImpl>::MeasureSweep(size_t levels, size_t orders_per_level){
+		size_t base = 10000;
+		OrderBookImpl swept(true);
+		OrderBookImpl removed(true);
+		uint64_t id = 1;
+		for(size_t j = 0; j < levels; ++j){
+			for(size_t k = 0; k < orders_per_level; ++k, ++id){
+				Order ask(Id(id), FromTicks(base + j), Count(count_dist_(mt_)), Type::SELL);
+				swept.Add(ask);
+				removed.Add(ask);
+			}
+		}
+
+		std::vector<Fill> fills;
+		fills.reserve(levels*orders_per_level);
+		Order market(Id(id), Price(0, 0), Count(SIZE_MAX), Type::BUY);
+		market.flags_ = MARKET;
+		auto start = std::chrono::high_resolution_clock::now();
+		swept.Sweep(market, fills);
+		auto stop = std::chrono::high_resolution_clock::now();
+		size_t sweep_time = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+
+		start = std::chrono::high_resolution_clock::now();
+		for(uint64_t j = 1; j < id; ++j){
+			removed.Remove(j);
+		}
+		stop = std::chrono::high_resolution_clock::now();
+		size_t remove_time = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+
+		return {sweep_time, remove_time, fills.size()};
+	}
 
+	//Random buy limits for QuantityUpTo and random sizes up to half the asks for
+	//CostOf on a book of count orders, against pricing the same size from ShowTop10,
+	//which is what a caller could do before and which stops at depth 10.
 	template <typename OrderBookImpl>
-	size_t OrderBookTesting<OrderBookImpl>::MeasureOneThreadTop10(size_t count, size_t half_range){
-		size_t sum_time = 0;
-		for(int i = 0; i < 1; ++i){
-			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
-			std::vector orders = GenerateOrders(count+half_range, price_int_dist);
+	std::vector<std::vector<size_t>> OrderBookTesting<OrderBookImpl>::MeasureDepthQueries(const std::vector<size_t>& elements_count){
+		std::vector<std::vector<size_t>> result;
+		result.resize(3);
 
+		size_t queries = 10000;
+		for(size_t count: elements_count){
+			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+			std::vector orders = GenerateOrders(count, price_int_dist);
 			OrderBookImpl obj;
+			for(const auto& x: orders){
+				obj.Add(x);
+			}
+			std::vector<Order> limits = GenerateOrders(queries, price_int_dist);
+			size_t total = obj.QuantityUpTo(Type::BUY, FromTicks(SIZE_MAX/2));
+			std::uniform_int_distribution<size_t> size_dist(1, total/2 + 1);
+			std::vector<size_t> sizes(queries);
+			for(auto& x: sizes){
+				x = size_dist(mt_);
+			}
 
-			unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
+			size_t sum = 0;
+			auto start = std::chrono::high_resolution_clock::now();
+			for(const auto& x: limits){
+				sum += obj.QuantityUpTo(Type::BUY, x.price_);
+			}
+			auto stop = std::chrono::high_resolution_clock::now();
+			result[0].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()/queries);
 
+			start = std::chrono::high_resolution_clock::now();
+			for(size_t x: sizes){
+				sum += obj.CostOf(Type::BUY, x).notional_;
+			}
+			stop = std::chrono::high_resolution_clock::now();
+			result[1].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()/queries);
+
+			start = std::chrono::high_resolution_clock::now();
+			for(size_t x: sizes){
+				for(const auto& ask: obj.ShowTop10().top10_asks_){
+					size_t taken = std::min(x, ask.count_.val_);
+					sum += taken*ToTicks(ask.price_);
+					x -= taken;
+				}
+			}
+			stop = std::chrono::high_resolution_clock::now();
+			result[2].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()/queries);
 
-			for(size_t i = 0; i < count + half_range; ++i){
-				obj.Add(orders[i]);
+			if(sum == 0){
+				std::cerr << "Depth queries on an empty book" << std::endl;
 			}
+		}
+
+		return result;
+	}
+
+	//count orders are added and removed again, without the level feed and with it,
+	//and the feed is drained after every mutation. Against that, a consumer without
+	//the feed polls ShowTop10 after every mutation. Returns the time per mutation
+	//without and with the feed, the time per drained update and the time per poll.
+	template <typename OrderBookImpl>
+	std::vector<size_t> OrderBookTesting<OrderBookImpl>::MeasureLevelUpdates(size_t count){
+		std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)/100 + 1));
+		std::vector orders = GenerateOrders(count, price_int_dist);
+		size_t mutations = std::max<size_t>(1, 2*orders.size());
 
+		auto mutate = [&orders](OrderBookImpl& obj, auto after){
 			auto start = std::chrono::high_resolution_clock::now();
-			for(size_t i = 0; i < 2*half_range; ++i){
-				obj.ShowTop10();
+			for(const auto& x: orders){
+				obj.Add(x);
+				after();
+			}
+			for(const auto& x: orders){
+				obj.Remove(x.id_.val_);
+				after();
 			}
 			auto stop = std::chrono::high_resolution_clock::now();
-			sum_time += std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+			return static_cast<size_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+		};
+
+		OrderBookImpl plain;
+		size_t plain_time = mutate(plain, [](){});
+
+		OrderBookImpl fed;
+		fed.EnableLevelUpdates(1024);
+		LevelFeed::Cursor cursor;
+		std::vector<LevelUpdate> batch;
+		batch.reserve(1024);
+		size_t updates = 0;
+		size_t fed_time = mutate(fed, [&fed, &cursor, &batch, &updates](){
+			batch.clear();
+			updates += fed.DrainLevelUpdates(cursor, batch, 1024);
+		});
+
+		OrderBookImpl polled;
+		size_t polled_time = mutate(polled, [&polled](){
+			auto top = polled.ShowTop10();
+		});
+
+		return {plain_time/mutations, fed_time/mutations, (fed_time - std::min(fed_time, plain_time))/std::max<size_t>(1, updates),
+				(polled_time - std::min(polled_time, plain_time))/mutations};
+	}
+
+	//A fast move: asks one per tick, stops_per_level buy stops triggered at every ask
+	//price and sized to take exactly the next level, set off by one trade. Returns the
+	//time of the whole cascade, the number of triggered stops and the time per stop.
+	template <typename OrderBookImpl>
+	std::vector<size_t> OrderBookTesting<OrderBookImpl>::MeasureStopCascade(size_t levels, size_t stops_per_level){
+		size_t base = 10000;
+		size_t count = 10*stops_per_level;
+		OrderBookImpl obj;
+		uint64_t id = 1;
+		for(size_t j = 0; j < levels; ++j){
+			obj.Add(Order(Id(id++), FromTicks(base + j), Count(count), Type::SELL));
 		}
-		return sum_time/2/half_range;
+		for(size_t j = 0; j + 1 < levels; ++j){
+			for(size_t k = 0; k < stops_per_level; ++k){
+				Order stop(Id(id++), FromTicks(base + j + 1), Count(10), Type::BUY);
+				stop.flags_ = STOP_LIMIT;
+				OrderTerms terms;
+				terms.stop_ = FromTicks(base + j);
+				obj.Add(stop, terms);
+			}
+		}
+		size_t parked = obj.Parked();
+
+		auto start = std::chrono::high_resolution_clock::now();
+		obj.Add(Order(Id(id++), FromTicks(base), Count(count), Type::BUY));
+		auto stop = std::chrono::high_resolution_clock::now();
+
+		size_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+		size_t triggered = parked - obj.Parked();
+		return {time, triggered, triggered == 0 ? 0 : time/triggered};
+	}
+
+	//30% of the orders expire at a random tick in [1, ticks]. Time advances one tick
+	//at a time, first through ExpireOrders and then by scanning all orders at each
+	//tick and removing the expired ones one by one. Returns the time per expired
+	//order of both and the number of expired orders.
+	template <typename OrderBookImpl>
+	std::vector<size_t> OrderBookTesting<OrderBookImpl>::MeasureExpiry(size_t count, uint64_t ticks){
+		std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+		auto orders = GenerateOrders(count, price_int_dist);
+		std::bernoulli_distribution expires(0.3);
+		std::uniform_int_distribution<uint64_t> expiry_dist(1, ticks);
+		std::vector<uint64_t> expiries(orders.size());
+		for(auto& expiry: expiries){
+			expiry = expires(mt_) ? expiry_dist(mt_) : 0;
+		}
+
+		OrderBookImpl wheel;
+		OrderBookImpl scan;
+		for(size_t j = 0; j < orders.size(); ++j){
+			OrderTerms terms;
+			terms.expiry_ = expiries[j];
+			wheel.Add(orders[j], terms);
+			scan.Add(orders[j], terms);
+		}
+
+		size_t expired = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for(uint64_t now = 1; now <= ticks; ++now){
+			expired += wheel.ExpireOrders(now);
+		}
+		auto stop = std::chrono::high_resolution_clock::now();
+		size_t wheel_time = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+
+		start = std::chrono::high_resolution_clock::now();
+		for(uint64_t now = 1; now <= ticks; ++now){
+			for(size_t j = 0; j < orders.size(); ++j){
+				if(expiries[j] == now){
+					scan.Remove(orders[j].id_.val_);
+				}
+			}
+		}
+		stop = std::chrono::high_resolution_clock::now();
+		size_t scan_time = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+
+		size_t divisor = std::max<size_t>(1, expired);
+		return {wheel_time/divisor, scan_time/divisor, expired};
+	}
+
+
+	template <typename OrderBookImpl>
+	std::vector<size_t> OrderBookTesting<OrderBookImpl>::MeasureMemory(const std::vector<size_t>& elements_count){
+		std::vector<size_t> result;
+		for(size_t count: elements_count){
+			result.push_back(MeasureMemoryPerOrder(count));
+		}
+		return result;
+	}
+
+	template <typename OrderBookImpl>
+	size_t OrderBookTesting<OrderBookImpl>::MeasureMemoryPerOrder(size_t count){
+		std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+		std::vector orders = GenerateOrders(count, price_int_dist);
+
+		malloc_trim(0);
+		size_t before = ResidentMemory();
+		auto obj = std::make_unique<OrderBookImpl>();
+		for(auto x: orders){
+			obj->Add(x);
+		}
+		size_t after = ResidentMemory();
+
+		return after > before ? (after - before)/orders.size() : 0;
 	}
 
 
@@ -631,6 +2234,20 @@ namespace OrderBook{
 	}
 
 
+	template <typename OrderBookImpl>
+	std::vector<std::vector<size_t>> OrderBookTesting<OrderBookImpl>::MeasureConcurrentThreadsScaling(const std::vector<int>& threads, size_t count){
+		std::vector<std::vector<size_t>> result;
+		result.resize(2);
+
+		for(int t: threads){
+			result[0].push_back(MeasureConcurrentThreadsRemove(count, 500, t));
+			result[1].push_back(MeasureConcurrentThreadsChange(count, 500, t));
+		}
+
+		return result;
+	}
+
+
 	template <typename OrderBookImpl>
 	size_t OrderBookTesting<OrderBookImpl>::MeasureConcurrentThreadsAdd(size_t count, size_t half_range){
 		std::atomic<size_t> sum_time{0};
@@ -675,7 +2292,7 @@ namespace OrderBook{
 
 
 	template <typename OrderBookImpl>
-	size_t OrderBookTesting<OrderBookImpl>::MeasureConcurrentThreadsRemove(size_t count, size_t half_range){
+	size_t OrderBookTesting<OrderBookImpl>::MeasureConcurrentThreadsRemove(size_t count, size_t half_range, int thread_count){
 		std::atomic<size_t> sum_time{0};
 		for(int i = 0; i < 1; ++i){
 			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
@@ -694,7 +2311,7 @@ namespace OrderBook{
 			seed = std::chrono::system_clock::now().time_since_epoch().count();
 			std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
 
-			int t_count = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+			int t_count = thread_count > 0 ? thread_count : std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
 			std::barrier sync_point(t_count);
 			std::vector<std::thread> threads;
 			threads.reserve(t_count);
@@ -720,7 +2337,7 @@ namespace OrderBook{
 
 
 	template <typename OrderBookImpl>
-	size_t OrderBookTesting<OrderBookImpl>::MeasureConcurrentThreadsChange(size_t count, size_t half_range){
+	size_t OrderBookTesting<OrderBookImpl>::MeasureConcurrentThreadsChange(size_t count, size_t half_range, int thread_count){
 		std::atomic<size_t> sum_time{0};
 		for(int i = 0; i < 1; ++i){
 			std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
@@ -744,7 +2361,7 @@ namespace OrderBook{
 
 
 
-			int t_count = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+			int t_count = thread_count > 0 ? thread_count : std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
 			std::barrier sync_point(t_count);
 			std::vector<std::thread> threads;
 			threads.reserve(t_count);
@@ -812,6 +2429,267 @@ namespace OrderBook{
 	}
 
 
+	template <typename OrderBookImpl>
+	std::vector<std::vector<size_t>> OrderBookTesting<OrderBookImpl>::MeasureConcurrentReaders(){
+		std::vector<size_t> elements_count = {1000, 5000, 10000, 50000};
+		std::vector<std::vector<size_t>> result;
+		result.resize(2);
+
+		for(size_t count: elements_count){
+			result[0].push_back(MeasureConcurrentReadersTop10(count, 500, false));
+			result[1].push_back(MeasureConcurrentReadersTop10(count, 500, true));
+		}
+
+		return result;
+	}
+
+
+	//Half of the threads keep changing orders while the other half read the top,
+	//either through ShowTop10 or through the published snapshot. Returns read latency.
+	template <typename OrderBookImpl>
+	size_t OrderBookTesting<OrderBookImpl>::MeasureConcurrentReadersTop10(size_t count, size_t half_range, bool snapshot){
+		std::atomic<size_t> sum_time{0};
+		std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+		std::vector orders = GenerateOrders(count+half_range, price_int_dist);
+
+		OrderBookImpl obj;
+
+		unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
+		std::shuffle(orders.begin(), orders.end(), std::default_random_engine(seed));
+
+		for(size_t i = 0; i < orders.size(); ++i){
+			obj.Add(orders[i]);
+		}
+		for(size_t i = 0; i < 2*half_range; ++i){
+			orders[i].price_ = GenerateRandomOrder(price_int_dist).price_;
+		}
+
+		int t_count = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+		int w_count = t_count/2;
+		int r_count = t_count - w_count;
+		std::atomic<int> readers_left{r_count};
+		std::barrier sync_point(t_count);
+		std::vector<std::thread> threads;
+		threads.reserve(t_count);
+		for(int t = 0; t < w_count; ++t){
+			threads.emplace_back([&orders,&obj,&sync_point,&readers_left,t,w_count,half_range](){
+				sync_point.arrive_and_wait();
+				while(readers_left.load() > 0){
+					for(size_t i = t; i < 2*half_range && readers_left.load() > 0; i+=w_count){
+						obj.Change(orders[i]);
+					}
+				}
+			});
+		}
+		for(int t = 0; t < r_count; ++t){
+			threads.emplace_back([&sum_time,&obj,&sync_point,&readers_left,half_range,snapshot](){
+				sync_point.arrive_and_wait();
+				auto start = std::chrono::high_resolution_clock::now();
+				for(size_t i = 0; i < 2*half_range; ++i){
+					if(snapshot){
+						obj.ShowTop10Snapshot();
+					}else{
+						obj.ShowTop10();
+					}
+				}
+				auto stop = std::chrono::high_resolution_clock::now();
+				sum_time.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+				readers_left.fetch_sub(1);
+			});
+		}
+
+		for(auto& t: threads){
+			t.join();
+		}
+
+		return sum_time.load()/r_count/2/half_range;
+	}
+
+	//One writer changes count orders while readers fetch the top every 100 us, first
+	//each through ShowTop10 on the book, then each through its own Consumer of a
+	//publisher on a 1 ms timer. Returns the time per Change and per read with direct
+	//reads, the same with the publisher, and the snapshots the consumers skipped.
+	template <typename OrderBookImpl>
+	std::vector<size_t> OrderBookTesting<OrderBookImpl>::MeasureSnapshotReaders(size_t count, int readers){
+		std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+		std::vector orders = GenerateOrders(count, price_int_dist);
+		std::vector<size_t> result;
+
+		for(bool published: {false, true}){
+			OrderBookImpl obj(10, 0, std::chrono::microseconds(published ? 1000 : 0));
+			for(const auto& x: orders){
+				obj.Add(x);
+			}
+			std::vector<Order> changed = orders;
+			for(auto& x: changed){
+				x.price_ = GenerateRandomOrder(price_int_dist).price_;
+			}
+
+			std::atomic<bool> done{false};
+			std::atomic<size_t> reads{0};
+			std::atomic<size_t> read_time{0};
+			std::atomic<size_t> skipped{0};
+			std::barrier sync_point(readers + 1);
+			std::vector<std::thread> threads;
+			threads.reserve(readers);
+			for(int t = 0; t < readers; ++t){
+				threads.emplace_back([&obj,&done,&reads,&read_time,&skipped,&sync_point,published](){
+					typename OrderBookImpl::Consumer consumer(obj);
+					size_t local_reads = 0;
+					size_t local_time = 0;
+					sync_point.arrive_and_wait();
+					while(!done.load(std::memory_order_relaxed)){
+						auto start = std::chrono::high_resolution_clock::now();
+						if(published){
+							consumer.Poll();
+						}else{
+							obj.ShowTop10();
+						}
+						auto stop = std::chrono::high_resolution_clock::now();
+						local_time += std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+						++local_reads;
+						std::this_thread::sleep_for(std::chrono::microseconds(100));
+					}
+					reads.fetch_add(local_reads);
+					read_time.fetch_add(local_time);
+					skipped.fetch_add(consumer.Skipped());
+				});
+			}
+
+			sync_point.arrive_and_wait();
+			auto start = std::chrono::high_resolution_clock::now();
+			for(const auto& x: changed){
+				obj.Change(x);
+			}
+			auto stop = std::chrono::high_resolution_clock::now();
+			done.store(true);
+			for(auto& t: threads){
+				t.join();
+			}
+
+			result.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()/std::max<size_t>(1, changed.size()));
+			result.push_back(read_time.load()/std::max<size_t>(1, reads.load()));
+			if(published){
+				result.push_back(skipped.load());
+			}
+		}
+
+		return result;
+	}
+
+	//count orders are added and removed again, without the order feed and with it,
+	//and the feed is drained after every mutation. Then count orders are walked through
+	//a snapshot cursor in chunks of 256. Returns the time per mutation without and with
+	//the feed, the added time per event and the time per order of the snapshot walk.
+	template <typename OrderBookImpl>
+	std::vector<size_t> OrderBookTesting<OrderBookImpl>::MeasureOrderEvents(size_t count){
+		std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)/100 + 1));
+		std::vector orders = GenerateOrders(count, price_int_dist);
+		size_t mutations = std::max<size_t>(1, 2*orders.size());
+
+		auto mutate = [&orders](OrderBookImpl& obj, auto after){
+			auto start = std::chrono::high_resolution_clock::now();
+			for(const auto& x: orders){
+				obj.Add(x);
+				after();
+			}
+			for(const auto& x: orders){
+				obj.Remove(x.id_.val_);
+				after();
+			}
+			auto stop = std::chrono::high_resolution_clock::now();
+			return static_cast<size_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+		};
+
+		OrderBookImpl plain;
+		size_t plain_time = mutate(plain, [](){});
+
+		OrderBookImpl fed;
+		fed.EnableOrderEvents(1024);
+		OrderFeed::Cursor feed_cursor;
+		std::vector<OrderEvent> batch;
+		batch.reserve(1024);
+		size_t events = 0;
+		size_t fed_time = mutate(fed, [&fed, &feed_cursor, &batch, &events](){
+			batch.clear();
+			events += fed.DrainOrderEvents(feed_cursor, batch, 1024);
+		});
+
+		OrderBookImpl walked;
+		for(const auto& x: orders){
+			walked.Add(x);
+		}
+		std::vector<Order> chunk(256);
+		size_t copied = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		auto cursor = walked.SnapshotOrders();
+		while(size_t n = cursor.Next(chunk)){
+			copied += n;
+		}
+		auto stop = std::chrono::high_resolution_clock::now();
+		size_t walk_time = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+
+		return {plain_time/mutations, fed_time/mutations, (fed_time - std::min(fed_time, plain_time))/std::max<size_t>(1, events),
+				walk_time/std::max<size_t>(1, copied)};
+	}
+
+	//Drives count orders through OrderBookManager with symbols drawn from a Zipf
+	//distribution (weight of the k-th symbol is 1/k^exponent): every order is added,
+	//changed and removed via Submit. Returns total operations per second, the mean
+	//latency of the hottest symbol and the mean of per-symbol mean latencies, in ns.
+	template <typename OrderBookImpl>
+	std::vector<size_t> OrderBookTesting<OrderBookImpl>::MeasureManagerZipf(size_t symbols, size_t count, double exponent, size_t workers){
+		std::vector<double> weights(symbols);
+		for(size_t k = 0; k < symbols; ++k){
+			weights[k] = 1.0/std::pow(static_cast<double>(k + 1), exponent);
+		}
+		std::discrete_distribution<uint32_t> symbol_dist(weights.begin(), weights.end());
+
+		std::normal_distribution<double> price_int_dist(static_cast<double>(count_dist_(mt_)), static_cast<double>(count_dist_(mt_)));
+		std::vector orders = GenerateOrders(count, price_int_dist);
+		std::vector<uint32_t> order_symbols(orders.size());
+		for(auto& symbol: order_symbols){
+			symbol = symbol_dist(mt_);
+		}
+
+		OrderBookManager manager(workers);
+		for(uint32_t symbol = 0; symbol < symbols; ++symbol){
+			manager.AddBook<OrderBookImpl>(symbol);
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for(size_t i = 0; i < orders.size(); ++i){
+			manager.Submit(order_symbols[i], OrderBookManager::Operation::ADD, orders[i]);
+		}
+		for(size_t i = 0; i < orders.size(); ++i){
+			Order changed = orders[i];
+			changed.count_.val_ = count_dist_(mt_);
+			manager.Submit(order_symbols[i], OrderBookManager::Operation::CHANGE, changed);
+		}
+		for(size_t i = 0; i < orders.size(); ++i){
+			manager.Submit(order_symbols[i], OrderBookManager::Operation::REMOVE, orders[i]);
+		}
+		manager.Flush();
+		auto stop = std::chrono::high_resolution_clock::now();
+		size_t time = std::max<size_t>(1, std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+
+		size_t active = 0;
+		size_t latency_sum = 0;
+		for(uint32_t symbol = 0; symbol < symbols; ++symbol){
+			auto stats = manager.Stats(symbol);
+			if(stats.processed_ != 0){
+				++active;
+				latency_sum += stats.latency_ns_/stats.processed_;
+			}
+		}
+		auto hot = manager.Stats(0);
+
+		return {3*orders.size()*1000000000/time,
+				hot.processed_ == 0 ? 0 : hot.latency_ns_/hot.processed_,
+				active == 0 ? 0 : latency_sum/active};
+	}
+
+
 	template <typename OrderBookImpl>
 	Order OrderBookTesting<OrderBookImpl>::GenerateRandomOrder(std::normal_distribution<double>& price_int_dist){
 		std::bernoulli_distribution type_dist(std::uniform_real_distribution<>{0.0,1.0}(mt_));
@@ -842,5 +2720,14 @@ namespace OrderBook{
 		return v;
 	}
 
+	template <typename OrderBookImpl>
+	size_t OrderBookTesting<OrderBookImpl>::ResidentMemory(){
+		size_t total = 0;
+		size_t resident = 0;
+		std::ifstream statm("/proc/self/statm");
+		statm >> total >> resident;
+		return resident*static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	}
+
 
 }
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace OrderBook{
+
+	//Hierarchical timing wheel over integer time units chosen by the caller. Level l
+	//has 256 slots of 256^l units each; an entry is kept at the lowest level whose
+	//current rotation contains its time and moves one level down when the wheel
+	//reaches its slot, so scheduling and firing cost O(1) per entry. Times beyond
+	//the top level wait in an overflow list. Every level keeps an occupancy bitmap,
+	//so Advance jumps straight to the next non-empty slot however far away it is;
+	//with only the overflow list left it jumps to the top rotation of its earliest
+	//entry. An Advance before anything was scheduled starts the clock at now, so
+	//absolute times such as nanoseconds since the epoch cost nothing extra.
+	//Entries cannot be cancelled; the owner ignores the ones that are no longer
+	//relevant when they fire.
+	template<typename T>
+	class TimerWheel{
+	public:
+		void Schedule(uint64_t when, T value);
+		template<typename F>
+		void Advance(uint64_t now, F f);
+
+	private:
+		static constexpr int kLevels = 4;
+		static constexpr int kBits = 8;
+		static constexpr size_t kSlots = size_t{1} << kBits;
+
+		struct Entry{
+			uint64_t when_;
+			T value_;
+		};
+
+		void Place(Entry entry);
+		size_t NextSlot(int level, size_t from) const;
+		template<typename F>
+		void Drain(std::vector<Entry>& entries, F& f);
+
+	private:
+		std::array<std::array<std::vector<Entry>, kSlots>, kLevels> slots_;
+		std::array<std::array<uint64_t, kSlots/64>, kLevels> occupied_{};
+		std::vector<Entry> overflow_;
+		std::vector<Entry> due_;
+		uint64_t now_ = 0;
+		bool scheduled_ = false;
+	};
+
+
+	template<typename T>
+	void TimerWheel<T>::Schedule(uint64_t when, T value){
+		scheduled_ = true;
+		Place({when, std::move(value)});
+	}
+
+	//Calls f for every entry with time not later than now. Each step moves to the
+	//start of the nearest occupied slot: a level 0 slot fires, a higher one is
+	//redistributed to the levels below.
+	template<typename T>
+	template<typename F>
+	void TimerWheel<T>::Advance(uint64_t now, F f){
+		if(!scheduled_){
+			now_ = std::max(now_, now);
+			return;
+		}
+		Drain(due_, f);
+		while(now_ < now){
+			int level = 0;
+			size_t slot = kSlots;
+			for(; level < kLevels; ++level){
+				slot = NextSlot(level, ((now_ >> (kBits*level)) & (kSlots - 1)) + 1);
+				if(slot < kSlots){
+					break;
+				}
+			}
+			uint64_t time;
+			if(level < kLevels){
+				int shift = kBits*(level + 1);
+				time = ((now_ >> shift) << shift) | (uint64_t{slot} << (kBits*level));
+			}else if(!overflow_.empty()){
+				uint64_t earliest = overflow_.front().when_;
+				for(const Entry& entry: overflow_){
+					earliest = std::min(earliest, entry.when_);
+				}
+				time = (earliest >> (kBits*kLevels)) << (kBits*kLevels);
+			}else{
+				time = 0;
+			}
+			if(time == 0 || time > now){
+				now_ = now;
+				break;
+			}
+			now_ = time;
+			std::vector<Entry> moved;
+			if(level < kLevels){
+				occupied_[level][slot/64] &= ~(uint64_t{1} << (slot % 64));
+				moved.swap(slots_[level][slot]);
+			}else{
+				moved.swap(overflow_);
+			}
+			for(Entry& entry: moved){
+				Place(std::move(entry));
+			}
+			Drain(due_, f);
+		}
+	}
+
+	template<typename T>
+	void TimerWheel<T>::Place(Entry entry){
+		if(entry.when_ <= now_){
+			due_.push_back(std::move(entry));
+			return;
+		}
+		for(int level = 0; level < kLevels; ++level){
+			int shift = kBits*(level + 1);
+			if((entry.when_ >> shift) == (now_ >> shift)){
+				size_t slot = (entry.when_ >> (kBits*level)) & (kSlots - 1);
+				occupied_[level][slot/64] |= uint64_t{1} << (slot % 64);
+				slots_[level][slot].push_back(std::move(entry));
+				return;
+			}
+		}
+		overflow_.push_back(std::move(entry));
+	}
+
+	//First occupied slot of level at or after from, kSlots if none.
+	template<typename T>
+	size_t TimerWheel<T>::NextSlot(int level, size_t from) const{
+		for(size_t word = from/64; word < kSlots/64; ++word){
+			uint64_t bits = occupied_[level][word];
+			if(word == from/64){
+				bits &= ~uint64_t{0} << (from % 64);
+			}
+			if(bits != 0){
+				return word*64 + std::countr_zero(bits);
+			}
+		}
+		return kSlots;
+	}
+
+	template<typename T>
+	template<typename F>
+	void TimerWheel<T>::Drain(std::vector<Entry>& entries, F& f){
+		for(Entry& entry: entries){
+			f(entry.value_);
+		}
+		entries.clear();
+	}
+
+}
@@ -0,0 +1,36 @@
+#include "ConcurrentOrderBook_Blocks.h"
+
+namespace OrderBook{
+
+	bool ConcurrentOrderBook_Blocks::Add(Order order){
+		bool success = false;
+		if(order.type_ == Type::BUY){
+			success = bids_.Add(std::move(order));
+		}else if(order.type_ == Type::SELL){
+			success = asks_.Add(std::move(order));
+		}
+
+		return success;
+	}
+
+	bool ConcurrentOrderBook_Blocks::Remove(uint64_t id){
+		return bids_.Remove(id) || asks_.Remove(id);
+	}
+
+	bool ConcurrentOrderBook_Blocks::Change(Order order){
+		Remove(order.id_.val_);
+		return Add(std::move(order));
+	}
+
+
+
+	ConcurrentOrderBook_Blocks::BothTop10 ConcurrentOrderBook_Blocks::ShowTop10() const{
+		return {bids_.ShowTop10(),asks_.ShowTop10()};
+	}
+
+	TopSizes ConcurrentOrderBook_Blocks::ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const{
+		return {bids_.ShowTopN(n, bids), asks_.ShowTopN(n, asks)};
+	}
+
+
+}
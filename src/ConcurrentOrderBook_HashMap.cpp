@@ -1,4 +1,3 @@
-
 #include "ConcurrentOrderBook_HashMap.h"
 
 namespace OrderBook{
@@ -9,12 +8,21 @@ namespace OrderBook{
 	
 		bool success = false;
 		uint64_t id = order.id_.val_;
+		OrderStorage::accessor a;
 		if(order.type_ == Type::BUY){
 			std::shared_lock lk(sh_mutex_b);
-			success = bids_.insert({id, std::move(order)});
+			success = bids_.insert(a, id);
+			if(success){
+				a->second = std::move(order);
+				top_bids_.Add(a->second);
+			}
 		}else if(order.type_ == Type::SELL){
 			std::shared_lock lk(sh_mutex_a);
-			success = asks_.insert({id, std::move(order)});
+			success = asks_.insert(a, id);
+			if(success){
+				a->second = std::move(order);
+				top_asks_.Add(a->second);
+			}
 		}
 		
 		return success;
@@ -23,19 +31,22 @@ namespace OrderBook{
 	bool ConcurrentOrderBook_HashMap::Remove(uint64_t id){
 
 		OrderStorage::accessor a;
-		bool success = bids_.find(a, id);
-		if(success) {
+		{
 			std::shared_lock lk(sh_mutex_b);
-			return bids_.erase(a);
+			if(bids_.find(a, id)) {
+				top_bids_.Remove(a->second);
+				return bids_.erase(a);
+			}
 		}
-		a.release();
-		success = asks_.find(a, id);
-		if(success) {
+		{
 			std::shared_lock lk(sh_mutex_a);
-			return asks_.erase(a);
+			if(asks_.find(a, id)) {
+				top_asks_.Remove(a->second);
+				return asks_.erase(a);
+			}
 		}
 
-		return success;
+		return false;
 	}
 	
 	bool ConcurrentOrderBook_HashMap::Change(Order order){
@@ -43,30 +54,31 @@ namespace OrderBook{
 		return Add(std::move(order));
 	}
 
+	bool ConcurrentOrderBook_HashMap::Modify(Order order){
+		uint64_t id = order.id_.val_;
+		size_t count = order.count_.val_;
+		bool reduced = false;
+		if(order.type_ == Type::BUY){
+			reduced = Shrink(bids_, top_bids_, sh_mutex_b, id, count, order.price_);
+		}else if(order.type_ == Type::SELL){
+			reduced = Shrink(asks_, top_asks_, sh_mutex_a, id, count, order.price_);
+		}
+		return reduced || Change(std::move(order));
+	}
+
+	bool ConcurrentOrderBook_HashMap::Reduce(uint64_t id, size_t count){
+		return Shrink(bids_, top_bids_, sh_mutex_b, id, count, std::nullopt) ||
+				Shrink(asks_, top_asks_, sh_mutex_a, id, count, std::nullopt);
+	}
+
 
 
 	ConcurrentOrderBook_HashMap::BothTop10 ConcurrentOrderBook_HashMap::ShowTop10() const{
-		std::vector<Order> copy_b;
-		std::vector<Order> copy_a;
-		size_t size;
-		{
-			std::lock_guard lk_(sh_mutex_b);
-			size = bids_.size();
-			copy_b.reserve(size);
-			for(auto It = bids_.begin(); It != bids_.end(); ++It){
-				copy_b.push_back(It->second);
-			}
-		}
-		{
-			std::lock_guard lk_(sh_mutex_a);
-			size = asks_.size();
-			copy_a.reserve(size);
-			for(auto It = asks_.begin(); It != asks_.end(); ++It){
-				copy_a.push_back(It->second);
-			}
-		}
+		return {ShowTop(bids_, top_bids_, sh_mutex_b, 10),ShowTop(asks_, top_asks_, sh_mutex_a, 10)};
+	}
 
-		return {FindTop10<std::greater<Order>>(copy_b),FindTop10<std::less<Order>>(copy_a)};
+	TopSizes ConcurrentOrderBook_HashMap::ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const{
+		return {ShowTopN(bids_, top_bids_, sh_mutex_b, n, bids), ShowTopN(asks_, top_asks_, sh_mutex_a, n, asks)};
 	}
 
 
@@ -10,13 +10,21 @@ namespace OrderBook{
 			Pair_bid res = bids_.Add(std::move(order));
 			success = res.second;
 			if(success){
-				success = orders_bids_.insert({id, res.first});
+				OrderStorage_bids::accessor b;
+				success = orders_bids_.insert(b, {id, res.first});
+				if(success){
+					Record(OrderEvent::Kind::ADD, *res.first);
+				}
 			}
 		}else if(order.type_ == Type::SELL){
 			Pair_ask res = asks_.Add(std::move(order));
 			success = res.second;
 			if(success){
-				success = orders_asks_.insert({id, res.first});
+				OrderStorage_asks::accessor a;
+				success = orders_asks_.insert(a, {id, res.first});
+				if(success){
+					Record(OrderEvent::Kind::ADD, *res.first);
+				}
 			}
 		}
 		
@@ -28,7 +36,9 @@ namespace OrderBook{
 		OrderStorage_bids::accessor b;
 		bool success = orders_bids_.find(b, id);
 		if(success) {
+			Order order = *b->second;
 			bids_.Remove(b->second);
+			Record(OrderEvent::Kind::CANCEL, order);
 			orders_bids_.erase(b);
 			return;
 		}
@@ -36,7 +46,9 @@ namespace OrderBook{
 		OrderStorage_asks::accessor a;
 		success = orders_asks_.find(a, id);
 		if(success) {
+			Order order = *a->second;
 			asks_.Remove(a->second);
+			Record(OrderEvent::Kind::CANCEL, order);
 			orders_asks_.erase(a);
 			return;
 		}
@@ -47,11 +59,74 @@ namespace OrderBook{
 		return Add(std::move(order));
 	}
 
+	bool ConcurrentOrderBook_HashSet::Modify(Order order){
+		uint64_t id = order.id_.val_;
+		size_t count = order.count_.val_;
+		bool reduced = false;
+		if(order.type_ == Type::BUY){
+			reduced = Shrink(orders_bids_, bids_, id, count, order.price_);
+		}else if(order.type_ == Type::SELL){
+			reduced = Shrink(orders_asks_, asks_, id, count, order.price_);
+		}
+		return reduced || Change(std::move(order));
+	}
+
+	bool ConcurrentOrderBook_HashSet::Reduce(uint64_t id, size_t count){
+		return Shrink(orders_bids_, bids_, id, count, std::nullopt) || Shrink(orders_asks_, asks_, id, count, std::nullopt);
+	}
+
+	void ConcurrentOrderBook_HashSet::EnableOrderEvents(size_t capacity){
+		feed_ = std::make_unique<OrderFeed>(capacity);
+	}
+
+	size_t ConcurrentOrderBook_HashSet::DrainOrderEvents(OrderFeed::Cursor& cursor, std::vector<OrderEvent>& batch, size_t max) const{
+		return feed_ ? feed_->Drain(cursor, batch, max) : 0;
+	}
+
+	ConcurrentOrderBook_HashSet::OrderCursor ConcurrentOrderBook_HashSet::SnapshotOrders() const{
+		return OrderCursor(*this, feed_ ? feed_->Claimed() : 0);
+	}
+
+	//Called after the change to the book, under the accessor of the order's id.
+	void ConcurrentOrderBook_HashSet::Record(OrderEvent::Kind kind, const Order& order){
+		if(feed_){
+			feed_->Publish(kind, order);
+		}
+	}
+
+	//Copies the next chunk of at most orders.size() orders and returns its size, 0 once
+	//both sides are walked.
+	size_t ConcurrentOrderBook_HashSet::OrderCursor::Next(std::span<Order> orders){
+		for(;;){
+			size_t count = asks_ ? book_->asks_.CopyAfter(last_, orders) : book_->bids_.CopyAfter(last_, orders);
+			if(count != 0){
+				last_ = orders[count - 1];
+				return count;
+			}
+			if(asks_ || orders.empty()){
+				return 0;
+			}
+			asks_ = true;
+			last_.reset();
+		}
+	}
+
 
 	
 	ConcurrentOrderBook_HashSet::BothTop10 ConcurrentOrderBook_HashSet::ShowTop10() const{
 		return {bids_.ShowTop10(),asks_.ShowTop10()};
 	}
 
+	TopSizes ConcurrentOrderBook_HashSet::ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const{
+		return {bids_.ShowTopN(n, bids), asks_.ShowTopN(n, asks)};
+	}
+
+	ConcurrentOrderBook_HashSet::BothTop10Snapshot ConcurrentOrderBook_HashSet::ShowTop10Snapshot() const{
+		BothTop10Snapshot result;
+		result.bids_size_ = bids_.ShowTop10Snapshot(result.top10_bids_);
+		result.asks_size_ = asks_.ShowTop10Snapshot(result.top10_asks_);
+		return result;
+	}
+
 
 }
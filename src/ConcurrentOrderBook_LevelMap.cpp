@@ -0,0 +1,51 @@
+#include "ConcurrentOrderBook_LevelMap.h"
+
+namespace OrderBook{
+
+	bool ConcurrentOrderBook_LevelMap::Add(Order order){
+		bool success = false;
+		if(order.type_ == Type::BUY){
+			success = bids_.Add(std::move(order));
+		}else if(order.type_ == Type::SELL){
+			success = asks_.Add(std::move(order));
+		}
+
+		return success;
+	}
+
+	bool ConcurrentOrderBook_LevelMap::Remove(uint64_t id){
+		return bids_.Remove(id) || asks_.Remove(id);
+	}
+
+	bool ConcurrentOrderBook_LevelMap::Change(Order order){
+		Remove(order.id_.val_);
+		return Add(std::move(order));
+	}
+
+
+
+	ConcurrentOrderBook_LevelMap::BothTop10 ConcurrentOrderBook_LevelMap::ShowTop10() const{
+		return {bids_.ShowTop10(),asks_.ShowTop10()};
+	}
+
+	TopSizes ConcurrentOrderBook_LevelMap::ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const{
+		return {bids_.ShowTopN(n, bids), asks_.ShowTopN(n, asks)};
+	}
+
+	ConcurrentOrderBook_LevelMap::BothTopLevels ConcurrentOrderBook_LevelMap::ShowTopLevels(size_t n) const{
+		std::scoped_lock lk(bids_.Mutex(), asks_.Mutex());
+		return {bids_.TopLevels(n), asks_.TopLevels(n), feed_ ? feed_->Claimed() : 0};
+	}
+
+	void ConcurrentOrderBook_LevelMap::EnableLevelUpdates(size_t capacity){
+		feed_ = std::make_unique<LevelFeed>(capacity);
+		bids_.SetFeed(feed_.get());
+		asks_.SetFeed(feed_.get());
+	}
+
+	size_t ConcurrentOrderBook_LevelMap::DrainLevelUpdates(LevelFeed::Cursor& cursor, std::vector<LevelUpdate>& batch, size_t max) const{
+		return feed_ ? feed_->Drain(cursor, batch, max) : 0;
+	}
+
+
+}
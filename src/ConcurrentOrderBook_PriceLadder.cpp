@@ -0,0 +1,223 @@
+#include "ConcurrentOrderBook_PriceLadder.h"
+#include "oneapi/tbb/blocked_range.h"
+#include "oneapi/tbb/parallel_scan.h"
+
+namespace OrderBook{
+
+	template<typename I>
+	PriceLadderBook<I>::PriceLadderBook(bool matching, bool time_priority, SelfTrade self_trade): bids_(time_priority),
+																			asks_(time_priority), matching_(matching), self_trade_(self_trade){}
+
+	template<typename I>
+	bool PriceLadderBook<I>::Add(Order order, OrderTerms terms){
+		if(matching_){
+			return Add(std::move(order), terms, [](const Fill&){});
+		}
+		bool success = false;
+		if(order.type_ == Type::BUY){
+			success = bids_.Add(std::move(order), terms);
+		}else if(order.type_ == Type::SELL){
+			success = asks_.Add(std::move(order), terms);
+		}
+
+		return success;
+	}
+
+	template<typename I>
+	bool PriceLadderBook<I>::Remove(uint64_t id){
+		return bids_.Remove(id) || asks_.Remove(id);
+	}
+
+	template<typename I>
+	bool PriceLadderBook<I>::Change(Order order, OrderTerms terms){
+		Remove(order.id_.val_);
+		return Add(std::move(order), terms);
+	}
+
+	template<typename I>
+	bool PriceLadderBook<I>::Modify(Order order){
+		uint64_t id = order.id_.val_;
+		size_t count = order.count_.val_;
+		bool reduced = false;
+		if(order.type_ == Type::BUY){
+			reduced = bids_.Reduce(id, count, order.price_);
+		}else if(order.type_ == Type::SELL){
+			reduced = asks_.Reduce(id, count, order.price_);
+		}
+		if(reduced){
+			return true;
+		}
+		std::optional<OrderTerms> terms = bids_.TermsOf(id);
+		if(!terms){
+			terms = asks_.TermsOf(id);
+		}
+		return Change(std::move(order), terms.value_or(OrderTerms{}));
+	}
+
+	template<typename I>
+	bool PriceLadderBook<I>::Reduce(uint64_t id, size_t count){
+		return bids_.Reduce(id, count) || asks_.Reduce(id, count);
+	}
+
+	template<typename I>
+	size_t PriceLadderBook<I>::Sweep(Order order, std::vector<Fill>& fills){
+		fills.clear();
+		size_t executed = 0;
+		Add(std::move(order), [&fills, &executed](const Fill& fill){
+			fills.push_back(fill);
+			executed += fill.count_.val_;
+		});
+		return executed;
+	}
+
+	template<typename I>
+	void PriceLadderBook<I>::SetProtectionBand(size_t ticks){
+		std::scoped_lock lk(bids_.Mutex(), asks_.Mutex());
+		band_ = ticks;
+	}
+
+	template<typename I>
+	size_t PriceLadderBook<I>::ExpireOrders(uint64_t now){
+		return bids_.Expire(now) + asks_.Expire(now);
+	}
+
+
+
+	template<typename I>
+	void PriceLadderBook<I>::EnableLevelUpdates(size_t capacity){
+		feed_ = std::make_unique<LevelFeed>(capacity);
+		bids_.SetFeed(feed_.get());
+		asks_.SetFeed(feed_.get());
+	}
+
+	template<typename I>
+	size_t PriceLadderBook<I>::DrainLevelUpdates(LevelFeed::Cursor& cursor, std::vector<LevelUpdate>& batch, size_t max) const{
+		return feed_ ? feed_->Drain(cursor, batch, max) : 0;
+	}
+
+	template<typename I>
+	void PriceLadderBook<I>::StartAuction(){
+		std::scoped_lock lk(bids_.Mutex(), asks_.Mutex());
+		auction_ = true;
+	}
+
+	//supply[i] is the ask volume at low + i or lower and demand[i] the bid volume at
+	//low + i or higher; both come out of one scan that walks the asks up from low and
+	//the bids down from high. The chosen volume is then taken off each side by Take
+	//with a synthetic order limited at the auction price, and the two lists of
+	//executions are paired into fills.
+	template<typename I>
+	std::vector<Fill> PriceLadderBook<I>::Uncross(){
+		std::scoped_lock lk(bids_.Mutex(), asks_.Mutex());
+		auction_ = false;
+		size_t low = asks_.BestTick();
+		size_t high = bids_.BestTick();
+		if(low == asks_.kNoTick || high == bids_.kNoTick || low > high){
+			return {};
+		}
+
+		struct Totals{
+			size_t asks_ = 0;
+			size_t bids_ = 0;
+		};
+		size_t n = high - low + 1;
+		std::vector<size_t> supply(n);
+		std::vector<size_t> demand(n);
+		tbb::parallel_scan(tbb::blocked_range<size_t>(0, n), Totals{},
+			[this, low, high, n, &supply, &demand](const tbb::blocked_range<size_t>& range, Totals sum, bool is_final){
+				for(size_t i = range.begin(); i != range.end(); ++i){
+					sum.asks_ += asks_.DepthAt(low + i);
+					sum.bids_ += bids_.DepthAt(high - i);
+					if(is_final){
+						supply[i] = sum.asks_;
+						demand[n - 1 - i] = sum.bids_;
+					}
+				}
+				return sum;
+			},
+			[](const Totals& left, const Totals& right){
+				return Totals{left.asks_ + right.asks_, left.bids_ + right.bids_};
+			});
+
+		size_t best = 0;
+		size_t volume = 0;
+		size_t imbalance = SIZE_MAX;
+		for(size_t i = 0; i < n; ++i){
+			size_t executable = std::min(supply[i], demand[i]);
+			size_t surplus = std::max(supply[i], demand[i]) - executable;
+			if(executable > volume || (executable == volume && surplus < imbalance)){
+				best = i;
+				volume = executable;
+				imbalance = surplus;
+			}
+		}
+		if(volume == 0){
+			return {};
+		}
+
+		//The owner is read while the maker still rests, and only when it matters.
+		struct Executed{
+			Id id_;
+			size_t count_;
+			uint32_t owner_;
+		};
+		Price price = FromTicks(low + best);
+		bool guarded = self_trade_ != SelfTrade::NONE;
+		std::vector<Executed> sold;
+		std::vector<Executed> bought;
+		auto sell = [this, guarded, &sold](const Fill& fill){
+			sold.push_back({fill.maker_, fill.count_.val_, guarded ? asks_.OwnerOf(fill.maker_.val_) : 0});
+		};
+		auto buy = [this, guarded, &bought](const Fill& fill){
+			bought.push_back({fill.maker_, fill.count_.val_, guarded ? bids_.OwnerOf(fill.maker_.val_) : 0});
+		};
+		Order buyer(Id(0), price, Count(volume), Type::BUY);
+		Order seller(Id(0), price, Count(volume), Type::SELL);
+		asks_.Take(buyer, sell, SelfTrade::NONE);
+		bids_.Take(seller, buy, SelfTrade::NONE);
+
+		std::vector<Fill> fills;
+		fills.reserve(sold.size() + bought.size());
+		for(size_t i = 0, j = 0; i < sold.size() && j < bought.size();){
+			size_t count = std::min(sold[i].count_, bought[j].count_);
+			if(sold[i].owner_ == 0 || sold[i].owner_ != bought[j].owner_){
+				fills.push_back(Fill{sold[i].id_, bought[j].id_, price, Count(count)});
+			}
+			sold[i].count_ -= count;
+			bought[j].count_ -= count;
+			i += sold[i].count_ == 0;
+			j += bought[j].count_ == 0;
+		}
+		return fills;
+	}
+
+	template<typename I>
+	typename PriceLadderBook<I>::BothTop10 PriceLadderBook<I>::ShowTop10() const{
+		return {bids_.ShowTop10(),asks_.ShowTop10()};
+	}
+
+	template<typename I>
+	size_t PriceLadderBook<I>::QuantityUpTo(Type type, Price limit) const{
+		return type == Type::BUY ? asks_.QuantityUpTo(ToTicks(limit)) : bids_.QuantityUpTo(ToTicks(limit));
+	}
+
+	template<typename I>
+	FillCost PriceLadderBook<I>::CostOf(Type type, size_t quantity) const{
+		return type == Type::BUY ? asks_.CostOf(quantity) : bids_.CostOf(quantity);
+	}
+
+	template<typename I>
+	typename PriceLadderBook<I>::BothTopLevels PriceLadderBook<I>::ShowTopLevels(size_t n) const{
+		std::scoped_lock lk(bids_.Mutex(), asks_.Mutex());
+		return {bids_.TopLevels(n), asks_.TopLevels(n), feed_ ? feed_->Claimed() : 0};
+	}
+
+	template<typename I>
+	TopSizes PriceLadderBook<I>::ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const{
+		return {bids_.ShowTopN(n, bids), asks_.ShowTopN(n, asks)};
+	}
+
+	template class PriceLadderBook<OccupancyBitmap<1>>;
+	template class PriceLadderBook<OccupancyBitmap<3>>;
+
+}
@@ -0,0 +1,68 @@
+#include "ConcurrentOrderBook_Sharded.h"
+
+namespace OrderBook{
+
+	ConcurrentOrderBook_Sharded::ConcurrentOrderBook_Sharded(size_t band_ticks): asks_(band_ticks), bids_(band_ticks){}
+
+	bool ConcurrentOrderBook_Sharded::Add(Order order){
+		bool success = false;
+		uint64_t id = order.id_.val_;
+		if(order.type_ == Type::BUY){
+			auto res = bids_.Add(std::move(order));
+			success = res.second;
+			if(success){
+				success = orders_bids_.insert({id, res.first});
+				if(!success){
+					bids_.Remove(res.first);
+				}
+			}
+		}else if(order.type_ == Type::SELL){
+			auto res = asks_.Add(std::move(order));
+			success = res.second;
+			if(success){
+				success = orders_asks_.insert({id, res.first});
+				if(!success){
+					asks_.Remove(res.first);
+				}
+			}
+		}
+
+		return success;
+	}
+
+	bool ConcurrentOrderBook_Sharded::Remove(uint64_t id){
+
+		OrderStorage_bids::accessor b;
+		bool success = orders_bids_.find(b, id);
+		if(success) {
+			bids_.Remove(b->second);
+			return orders_bids_.erase(b);
+		}
+
+		OrderStorage_asks::accessor a;
+		success = orders_asks_.find(a, id);
+		if(success) {
+			asks_.Remove(a->second);
+			return orders_asks_.erase(a);
+		}
+
+		return success;
+	}
+
+	bool ConcurrentOrderBook_Sharded::Change(Order order){
+		Remove(order.id_.val_);
+		return Add(std::move(order));
+	}
+
+
+
+	ConcurrentOrderBook_Sharded::BothTop10 ConcurrentOrderBook_Sharded::ShowTop10() const{
+		return {bids_.ShowTop10(),asks_.ShowTop10()};
+	}
+
+	TopSizes ConcurrentOrderBook_Sharded::ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const{
+		return {bids_.ShowTopN(n, bids), asks_.ShowTopN(n, asks)};
+	}
+
+
+}
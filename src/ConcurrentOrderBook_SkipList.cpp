@@ -0,0 +1,66 @@
+#include "ConcurrentOrderBook_SkipList.h"
+
+namespace OrderBook{
+
+	bool ConcurrentOrderBook_SkipList::Add(Order order){
+		bool success = false;
+		uint64_t id = order.id_.val_;
+		if(order.type_ == Type::BUY){
+			auto node = bids_.Add(std::move(order));
+			success = node != nullptr;
+			if(success){
+				success = orders_bids_.insert({id, node});
+				if(!success){
+					bids_.Remove(node);
+				}
+			}
+		}else if(order.type_ == Type::SELL){
+			auto node = asks_.Add(std::move(order));
+			success = node != nullptr;
+			if(success){
+				success = orders_asks_.insert({id, node});
+				if(!success){
+					asks_.Remove(node);
+				}
+			}
+		}
+
+		return success;
+	}
+
+	bool ConcurrentOrderBook_SkipList::Remove(uint64_t id){
+
+		OrderStorage_bids::accessor b;
+		bool success = orders_bids_.find(b, id);
+		if(success) {
+			bids_.Remove(b->second);
+			return orders_bids_.erase(b);
+		}
+
+		OrderStorage_asks::accessor a;
+		success = orders_asks_.find(a, id);
+		if(success) {
+			asks_.Remove(a->second);
+			return orders_asks_.erase(a);
+		}
+
+		return success;
+	}
+
+	bool ConcurrentOrderBook_SkipList::Change(Order order){
+		Remove(order.id_.val_);
+		return Add(std::move(order));
+	}
+
+
+
+	ConcurrentOrderBook_SkipList::BothTop10 ConcurrentOrderBook_SkipList::ShowTop10() const{
+		return {bids_.ShowTop10(),asks_.ShowTop10()};
+	}
+
+	TopSizes ConcurrentOrderBook_SkipList::ShowTopN(size_t n, std::span<Order> bids, std::span<Order> asks) const{
+		return {bids_.ShowTopN(n, bids), asks_.ShowTopN(n, asks)};
+	}
+
+
+}
@@ -1,121 +1,175 @@
 #include <iostream>
+#include <string>
+#include <vector>
 #include "ConcurrentOrderBook_HashSet.h"
 #include "ConcurrentOrderBook_HashMap.h"
+#include "ConcurrentOrderBook_PriceLadder.h"
+#include "ConcurrentOrderBook_LevelMap.h"
+#include "ConcurrentOrderBook_SkipList.h"
+#include "ConcurrentOrderBook_Sharded.h"
+#include "ConcurrentOrderBook_Blocks.h"
+#include "FlatCombiningOrderBook.h"
+#include "OrderBookManager.h"
+#include "SnapshotPublisher.h"
+#include "StopOrderBook.h"
 #include "TestClass.h"
 
+void PrintMeasurements(const std::vector<std::string>& names, const std::vector<std::vector<size_t>>& result){
+	for(size_t i = 0; i < names.size(); ++i){
+		std::cout << names[i] << ":\n";
+		for(auto x: result[i]){
+			std::cout << x << " ";
+		}
+		std::cout << std::endl;
+	}
+}
+
+template<typename OrderBookImpl>
+void TestAndMeasure(){
+	OrderBook::OrderBookTesting<OrderBookImpl> test;
+	test.TestAll();
+
+	PrintMeasurements({"Add", "Remove", "Change", "Top10", "CancelBestTop10"}, test.MeasureOneThread());
+	PrintMeasurements({"ConcurrentAdd", "ConcurrentRemove", "ConcurrentChange", "ConcurrentTop10"},
+						test.MeasureConcurrentThreads());
+	PrintMeasurements({"TopN", "TopNArray"}, test.MeasureTopN(10000));
+}
+
+template<typename OrderBookImpl>
+void TestAndMeasureModify(){
+	OrderBook::OrderBookTesting<OrderBookImpl> test;
+	test.TestModifyAndTop10();
+
+	PrintMeasurements({"AmendChange", "AmendModify"}, test.MeasureAmends({1000, 10000}));
+}
+
+template<typename OrderBookImpl>
+void MeasureScaling(const std::vector<int>& threads){
+	OrderBook::OrderBookTesting<OrderBookImpl> test;
+
+	PrintMeasurements({"ScalingRemove", "ScalingChange"}, test.MeasureConcurrentThreadsScaling(threads, 50000));
+}
+
+template<typename OrderBookImpl>
+void MeasureLarge(const std::vector<size_t>& elements_count){
+	OrderBook::OrderBookTesting<OrderBookImpl> test;
+
+	PrintMeasurements({"Add", "Remove", "Change", "Top10", "CancelBestTop10"}, test.MeasureOneThread(elements_count));
+	PrintMeasurements({"MemoryPerOrder"}, {test.MeasureMemory(elements_count)});
+}
+
+template<typename OrderBookImpl>
+void MeasureManager(size_t symbols, size_t count){
+	OrderBook::OrderBookTesting<OrderBookImpl> test;
+
+	auto result = test.MeasureManagerZipf(symbols, count, 1.0);
+	PrintMeasurements({"ManagerOpsPerSecond", "ManagerHotSymbolLatency", "ManagerMeanSymbolLatency"},
+						{{result[0]}, {result[1]}, {result[2]}});
+}
+
 int main() {
 
-	OrderBook::OrderBookTesting<OrderBook::ConcurrentOrderBook_HashSet> test;
-    test.TestAll();
+	TestAndMeasure<OrderBook::ConcurrentOrderBook_HashSet>();
+	TestAndMeasureModify<OrderBook::ConcurrentOrderBook_HashSet>();
 
-    auto result = test.MeasureOneThread();
+	OrderBook::OrderBookTesting<OrderBook::ConcurrentOrderBook_HashSet> test_snapshot;
+	test_snapshot.ConcurrentTestAddAndSnapshotTop10();
+	PrintMeasurements({"ReadersTop10", "ReadersTop10Snapshot"}, test_snapshot.MeasureConcurrentReaders());
+	test_snapshot.ConcurrentTestOrderEvents();
+	auto order_events = test_snapshot.MeasureOrderEvents(100000);
+	PrintMeasurements({"MutationNoEvents", "MutationWithEvents", "OverheadPerEvent", "SnapshotPerOrder"},
+						{{order_events[0]}, {order_events[1]}, {order_events[2]}, {order_events[3]}});
 
-    std::cout << "Add:\n";
-	for(auto x: result[0]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	OrderBook::OrderBookTesting<OrderBook::SnapshotPublisher<OrderBook::ConcurrentOrderBook_HashSet>> test_publisher;
+	test_publisher.ConcurrentTestSnapshotPublisher();
+	auto readers = test_publisher.MeasureSnapshotReaders(100000, 32);
+	PrintMeasurements({"ChangeDirectReaders", "DirectRead", "ChangePublishedReaders", "PublishedRead", "SkippedSnapshots"},
+						{{readers[0]}, {readers[1]}, {readers[2]}, {readers[3]}, {readers[4]}});
 
-	std::cout << "Remove:\n";
-	for(auto x: result[1]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	/////////////////////////////////
 
-	std::cout << "Change:\n";
-	for(auto x: result[2]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	TestAndMeasure<OrderBook::ConcurrentOrderBook_HashMap>();
+	TestAndMeasureModify<OrderBook::ConcurrentOrderBook_HashMap>();
 
-	std::cout << "Top10:\n";
-	for(auto x: result[3]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	/////////////////////////////////
 
-	auto result1 = test.MeasureConcurrentThreads();
-	std::cout << "ConcurrentAdd:\n";
-	for(auto x: result1[0]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	TestAndMeasure<OrderBook::ConcurrentOrderBook_PriceLadder>();
+	TestAndMeasure<OrderBook::ConcurrentOrderBook_BitmapLadder>();
+	TestAndMeasureModify<OrderBook::ConcurrentOrderBook_BitmapLadder>();
+
+	OrderBook::OrderBookTesting<OrderBook::ConcurrentOrderBook_BitmapLadder> test_matching;
+	test_matching.TestMatching();
+	test_matching.TestImmediateOrders();
+	test_matching.TestIceberg();
+
+	OrderBook::OrderBookTesting<OrderBook::StopOrderBook<OrderBook::ConcurrentOrderBook_BitmapLadder>> test_stops;
+	test_stops.TestStopOrders();
+	auto cascade = test_stops.MeasureStopCascade(10000, 10);
+	PrintMeasurements({"StopCascade", "StopsTriggered", "StopCascadePerStop"}, {{cascade[0]}, {cascade[1]}, {cascade[2]}});
+	test_matching.ConcurrentTestTimePriority();
+	test_matching.TestExpiry();
+	auto expiry = test_matching.MeasureExpiry(100000, 1000);
+	PrintMeasurements({"ExpireWheelPerOrder", "ExpireScanPerOrder", "Expired"}, {{expiry[0]}, {expiry[1]}, {expiry[2]}});
+	PrintMeasurements({"Add", "MatchingAdd", "Fills"}, test_matching.MeasureMatching({10000, 100000, 1000000}));
+	test_matching.TestSelfTrade();
+	test_matching.TestMarketOrders();
+	test_matching.ConcurrentTestLevelUpdates();
+	auto ladder_updates = test_matching.MeasureLevelUpdates(100000);
+	PrintMeasurements({"MutationNoFeed", "MutationWithFeed", "DrainPerUpdate", "PollTop10PerMutation"},
+						{{ladder_updates[0]}, {ladder_updates[1]}, {ladder_updates[2]}, {ladder_updates[3]}});
+	auto sweep = test_matching.MeasureSweep(100, 100);
+	PrintMeasurements({"MarketSweep", "RemovePerOrderSweep", "SweepFills"}, {{sweep[0]}, {sweep[1]}, {sweep[2]}});
+	test_matching.TestDepthQueries();
+	PrintMeasurements({"QuantityUpTo", "CostOf", "Top10Cost"}, test_matching.MeasureDepthQueries({10000, 100000, 1000000}));
+	test_matching.TestAuction();
+	PrintMeasurements({"Uncross", "UncrossFills", "UncrossPerOrder"}, test_matching.MeasureUncross({100000, 1000000, 10000000}));
+	PrintMeasurements({"MatchingNoStp", "StpCancelNewest", "StpCancelOldest", "StpDecrementBoth"}, test_matching.MeasureSelfTrade({10000, 100000, 1000000}));
 
-	std::cout << "ConcurrentRemove:\n";
-	for(auto x: result1[1]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	/////////////////////////////////
 
-	std::cout << "ConcurrentChange:\n";
-	for(auto x: result1[2]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	OrderBook::OrderBookTesting<OrderBook::ConcurrentOrderBook_LevelMap> test_levels;
+	test_levels.TestAddAndTopLevels();
+	test_levels.ConcurrentTestLevelUpdates();
+	auto level_updates = test_levels.MeasureLevelUpdates(100000);
+	PrintMeasurements({"MutationNoFeed", "MutationWithFeed", "DrainPerUpdate", "PollTop10PerMutation"},
+						{{level_updates[0]}, {level_updates[1]}, {level_updates[2]}, {level_updates[3]}});
+	TestAndMeasure<OrderBook::ConcurrentOrderBook_LevelMap>();
 
-	std::cout << "ConcurrentTop10:\n";
-	for(auto x: result1[3]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
-	
 	/////////////////////////////////
-	
 
-	OrderBook::OrderBookTesting<OrderBook::ConcurrentOrderBook_HashMap> test1;
-	test1.TestAll();
-	
-	result = test1.MeasureOneThread();
+	TestAndMeasure<OrderBook::ConcurrentOrderBook_SkipList>();
 
-	std::cout << "Add:\n";
-	for(auto x: result[0]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	TestAndMeasure<OrderBook::ConcurrentOrderBook_Sharded>();
 
-	std::cout << "Remove:\n";
-	for(auto x: result[1]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	/////////////////////////////////
 
-	std::cout << "Change:\n";
-	for(auto x: result[2]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	TestAndMeasure<OrderBook::ConcurrentOrderBook_Blocks>();
 
-	std::cout << "Top10:\n";
-	for(auto x: result[3]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	/////////////////////////////////
 
+	TestAndMeasure<OrderBook::FlatCombiningOrderBook<OrderBook::ConcurrentOrderBook_HashSet>>();
+	TestAndMeasure<OrderBook::FlatCombiningOrderBook<OrderBook::ConcurrentOrderBook_HashMap>>();
+	TestAndMeasure<OrderBook::FlatCombiningOrderBook<OrderBook::ConcurrentOrderBook_PriceLadder>>();
 
-	result1 = test1.MeasureConcurrentThreads();
-	std::cout << "ConcurrentAdd:\n";
-	for(auto x: result1[0]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	std::vector<int> threads = {1, 2, 4, 8, 16, 32};
+	MeasureScaling<OrderBook::ConcurrentOrderBook_HashSet>(threads);
+	MeasureScaling<OrderBook::ConcurrentOrderBook_SkipList>(threads);
+	MeasureScaling<OrderBook::ConcurrentOrderBook_Sharded>(threads);
+	MeasureScaling<OrderBook::FlatCombiningOrderBook<OrderBook::ConcurrentOrderBook_HashSet>>(threads);
 
-	std::cout << "ConcurrentRemove:\n";
-	for(auto x: result1[1]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	/////////////////////////////////
 
-	std::cout << "ConcurrentChange:\n";
-	for(auto x: result1[2]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	std::vector<size_t> large_count = {10000, 100000, 1000000};
+	MeasureLarge<OrderBook::ConcurrentOrderBook_HashSet>(large_count);
+	MeasureLarge<OrderBook::ConcurrentOrderBook_PriceLadder>(large_count);
+	MeasureLarge<OrderBook::ConcurrentOrderBook_BitmapLadder>(large_count);
+	MeasureLarge<OrderBook::ConcurrentOrderBook_LevelMap>(large_count);
+	MeasureLarge<OrderBook::ConcurrentOrderBook_Blocks>(large_count);
 
-	std::cout << "ConcurrentTop10:\n";
-	for(auto x: result1[3]){
-		std::cout << x << " ";
-	}
-	std::cout << std::endl;
+	/////////////////////////////////
+
+	MeasureManager<OrderBook::ConcurrentOrderBook_HashSet>(8000, 1000000);
+	MeasureManager<OrderBook::ConcurrentOrderBook_BitmapLadder>(8000, 1000000);
 
 	return 0;
 }
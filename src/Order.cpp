@@ -40,6 +40,10 @@ namespace OrderBook{
 				 (left.integer_part_ == right.integer_part_ ? left.fractional_part_ > right.fractional_part_: false);
 	}
 
+	Price FromTicks(size_t ticks){
+		return Price(ticks/100, ticks%100);
+	}
+
 
 	Count::Count(){}
 	Count::Count(size_t count): val_(count){}
@@ -0,0 +1,147 @@
+#include "OrderBookManager.h"
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+
+namespace OrderBook{
+
+	OrderBookManager::OrderBookManager(size_t workers){
+		size_t cores = std::max(1u, std::thread::hardware_concurrency());
+		if(workers == 0){
+			workers = cores;
+		}
+		workers_.reserve(workers);
+		for(size_t i = 0; i < workers; ++i){
+			workers_.push_back(std::make_unique<Worker>());
+		}
+		for(size_t i = 0; i < workers; ++i){
+			Worker& worker = *workers_[i];
+			worker.thread_ = std::thread(&OrderBookManager::Run, this, i);
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+			CPU_SET(i % cores, &cpus);
+			pthread_setaffinity_np(worker.thread_.native_handle(), sizeof(cpus), &cpus);
+		}
+	}
+
+	OrderBookManager::~OrderBookManager(){
+		for(auto& worker: workers_){
+			{
+				std::lock_guard lk(worker->mutex_);
+				worker->stop_ = true;
+			}
+			worker->ready_.notify_one();
+		}
+		for(auto& worker: workers_){
+			worker->thread_.join();
+		}
+	}
+
+	bool OrderBookManager::AddBook(uint32_t symbol, std::unique_ptr<IOrderBook> book){
+		size_t worker = books_.size() % workers_.size();
+		return books_.emplace(symbol, Book{std::move(book), worker, {}}).second;
+	}
+
+	bool OrderBookManager::Add(uint32_t symbol, Order order){
+		auto It = books_.find(symbol);
+		return It != books_.end() && It->second.book_->Add(std::move(order));
+	}
+
+	bool OrderBookManager::Remove(uint32_t symbol, uint64_t id){
+		auto It = books_.find(symbol);
+		return It != books_.end() && It->second.book_->Remove(id);
+	}
+
+	bool OrderBookManager::Change(uint32_t symbol, Order order){
+		auto It = books_.find(symbol);
+		return It != books_.end() && It->second.book_->Change(std::move(order));
+	}
+
+	BothTop10Orders OrderBookManager::ShowTop10(uint32_t symbol) const{
+		auto It = books_.find(symbol);
+		if(It == books_.end()){
+			return {};
+		}
+		return It->second.book_->ShowTop10();
+	}
+
+	TopSizes OrderBookManager::ShowTopN(uint32_t symbol, size_t n, std::span<Order> bids, std::span<Order> asks) const{
+		auto It = books_.find(symbol);
+		if(It == books_.end()){
+			return {};
+		}
+		return It->second.book_->ShowTopN(n, bids, asks);
+	}
+
+	void OrderBookManager::Submit(uint32_t symbol, Operation operation, Order order){
+		auto It = books_.find(symbol);
+		if(It == books_.end()){
+			return;
+		}
+		Worker& worker = *workers_[It->second.worker_];
+		worker.submitted_.fetch_add(1, std::memory_order_relaxed);
+		bool was_empty;
+		{
+			std::lock_guard lk(worker.mutex_);
+			was_empty = worker.queue_.empty();
+			worker.queue_.push_back(Request{&It->second, operation, std::move(order), Clock::now()});
+		}
+		if(was_empty){
+			worker.ready_.notify_one();
+		}
+	}
+
+	void OrderBookManager::Flush() const{
+		for(const auto& worker: workers_){
+			while(worker->done_.load(std::memory_order_acquire) != worker->submitted_.load(std::memory_order_relaxed)){
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	OrderBookManager::BookStats OrderBookManager::Stats(uint32_t symbol) const{
+		auto It = books_.find(symbol);
+		if(It == books_.end()){
+			return {};
+		}
+		return It->second.stats_;
+	}
+
+	//Drains the queue before honouring stop_.
+	void OrderBookManager::Run(size_t index){
+		Worker& worker = *workers_[index];
+		std::vector<Request> batch;
+		while(true){
+			{
+				std::unique_lock lk(worker.mutex_);
+				worker.ready_.wait(lk, [&worker](){ return worker.stop_ || !worker.queue_.empty(); });
+				if(worker.queue_.empty()){
+					break;
+				}
+				batch.swap(worker.queue_);
+			}
+			for(Request& request: batch){
+				Apply(*request.book_, request);
+			}
+			worker.done_.fetch_add(batch.size(), std::memory_order_release);
+			batch.clear();
+		}
+	}
+
+	void OrderBookManager::Apply(Book& book, Request& request){
+		switch(request.operation_){
+		case Operation::ADD:
+			book.book_->Add(std::move(request.order_));
+			break;
+		case Operation::REMOVE:
+			book.book_->Remove(request.order_.id_.val_);
+			break;
+		case Operation::CHANGE:
+			book.book_->Change(std::move(request.order_));
+			break;
+		}
+		++book.stats_.processed_;
+		book.stats_.latency_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - request.submitted_).count();
+	}
+
+}